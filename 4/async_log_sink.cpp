@@ -0,0 +1,232 @@
+#include "async_log_sink.h"
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+AsyncLogOptions defaultAsyncLogOptions(LogFormat format) {
+    AsyncLogOptions options;
+    options.queueCapacity = 65536;
+    options.overflow = OverflowPolicy::DropNewest;
+    options.syncIntervalMs = 5000;
+    options.flush = defaultFlushPolicy();
+    options.format = format;
+    return options;
+}
+
+static size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+AsyncLogSink::AsyncLogSink(SegmentedLog &allReadings, SegmentedLog &hourlyAverages, SegmentedLog &dailyAverages,
+                           const AsyncLogOptions &options)
+    : allReadings_(allReadings), hourlyAverages_(hourlyAverages), dailyAverages_(dailyAverages), format_(options.format),
+      syncIntervalMs_(options.syncIntervalMs), ring_(roundUpToPowerOfTwo(options.queueCapacity)), mask_(ring_.size() - 1),
+      head_(0), tail_(0), consumerSleeping_(false), overflow_(static_cast<int>(options.overflow)), dropped_(0),
+      flushPolicy_(options.flush), flushRequested_(0), flushCompleted_(0) {
+}
+
+AsyncLogSink::~AsyncLogSink() {
+    stop();
+}
+
+void AsyncLogSink::start() {
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&AsyncLogSink::run, this);
+    }
+}
+
+void AsyncLogSink::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    Entry entry = {EntryKind::Stop, LogTarget::AllReadings, 0, 0.0};
+    push(entry, false);
+    thread_.join();
+}
+
+bool AsyncLogSink::write(LogTarget target, time_t time, double value) {
+    Entry entry = {EntryKind::Write, target, time, value};
+    return push(entry, target == LogTarget::AllReadings);
+}
+
+void AsyncLogSink::expire(time_t now) {
+    Entry entry = {EntryKind::Expire, LogTarget::AllReadings, now, 0.0};
+    push(entry, false);
+}
+
+void AsyncLogSink::flush() {
+    if (!thread_.joinable()) {
+        flushAll();
+        return;
+    }
+
+    unsigned long long ticket;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ticket = ++flushRequested_;
+    }
+
+    Entry entry = {EntryKind::Flush, LogTarget::AllReadings, 0, 0.0};
+    push(entry, false);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_.wait(lock, [this, ticket] { return flushCompleted_ >= ticket; });
+}
+
+void AsyncLogSink::setFlushPolicy(const FlushPolicy &policy) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushPolicy_ = policy;
+}
+
+void AsyncLogSink::setOverflowPolicy(OverflowPolicy policy) {
+    overflow_.store(static_cast<int>(policy));
+}
+
+unsigned long long AsyncLogSink::getDropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+bool AsyncLogSink::push(const Entry &entry, bool mayDrop) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    while (tail - head_.load(std::memory_order_acquire) >= ring_.size()) {
+        if (mayDrop && overflow_.load(std::memory_order_relaxed) == static_cast<int>(OverflowPolicy::DropNewest)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    ring_[tail & mask_] = entry;
+    // Both stores and the loads that follow them are seq_cst, so either this sees the
+    // consumer sleeping or the consumer's recheck sees the new tail; a release store
+    // here could be passed by the load and the wakeup lost.
+    tail_.store(tail + 1, std::memory_order_seq_cst);
+
+    if (consumerSleeping_.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wakeConsumer_.notify_one();
+    }
+    return true;
+}
+
+bool AsyncLogSink::pop(Entry &entry) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    entry = ring_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogSink::run() {
+    auto lastSync = std::chrono::steady_clock::now();
+    FlushPolicy policy;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        policy = flushPolicy_;
+    }
+
+    while (true) {
+        Entry entry;
+        bool stopping = false;
+        bool flushRequested = false;
+
+        while (pop(entry)) {
+            if (entry.kind == EntryKind::Write) {
+                writeEntry(entry, policy);
+            } else if (entry.kind == EntryKind::Expire) {
+                allReadings_.removeExpired(entry.time);
+                hourlyAverages_.removeExpired(entry.time);
+                dailyAverages_.removeExpired(entry.time);
+            } else if (entry.kind == EntryKind::Flush) {
+                flushRequested = true;
+            } else {
+                stopping = true;
+            }
+        }
+
+        allReadings_.flushIfDue(policy);
+        hourlyAverages_.flushIfDue(policy);
+        dailyAverages_.flushIfDue(policy);
+
+        auto now = std::chrono::steady_clock::now();
+        if (syncIntervalMs_ > 0 && now - lastSync >= std::chrono::milliseconds(syncIntervalMs_)) {
+            syncAll();
+            lastSync = now;
+        }
+
+        if (flushRequested || stopping) {
+            flushAll();
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushCompleted_ = flushRequested_;
+            flushed_.notify_all();
+        }
+        if (stopping) {
+            if (syncIntervalMs_ > 0) {
+                syncAll();
+            }
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        consumerSleeping_.store(true, std::memory_order_seq_cst);
+        if (head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_seq_cst)) {
+            int timeoutMs = policy.maxDelayMs;
+            if (syncIntervalMs_ > 0 && syncIntervalMs_ < timeoutMs) {
+                timeoutMs = syncIntervalMs_;
+            }
+            wakeConsumer_.wait_for(lock, std::chrono::milliseconds(timeoutMs));
+        }
+        consumerSleeping_.store(false);
+        policy = flushPolicy_;
+    }
+}
+
+void AsyncLogSink::writeEntry(const Entry &entry, const FlushPolicy &policy) {
+    SegmentedLog &segments = segmentsFor(entry.target);
+    if (format_ != LogFormat::Text) {
+        segments.appendRecord(entry.time, entry.value);
+    } else {
+        const char *timeFormat = entry.target == LogTarget::DailyAverage ? "%Y-%m-%d" : "%Y-%m-%d %H:%M:%S";
+        int precision = entry.target == LogTarget::AllReadings ? 1 : 2;
+
+        std::tm t;
+        localtime_r(&entry.time, &t);
+        std::stringstream ss;
+        ss << std::put_time(&t, timeFormat) << " - " << std::fixed << std::setprecision(precision) << entry.value;
+        segments.append(entry.time, ss.str());
+    }
+
+    if (entry.target != LogTarget::AllReadings && policy.flushOnAggregate) {
+        flushAll();
+    }
+}
+
+SegmentedLog &AsyncLogSink::segmentsFor(LogTarget target) {
+    if (target == LogTarget::HourlyAverage) {
+        return hourlyAverages_;
+    }
+    if (target == LogTarget::DailyAverage) {
+        return dailyAverages_;
+    }
+    return allReadings_;
+}
+
+void AsyncLogSink::flushAll() {
+    allReadings_.flush();
+    hourlyAverages_.flush();
+    dailyAverages_.flush();
+}
+
+void AsyncLogSink::syncAll() {
+    allReadings_.sync();
+    hourlyAverages_.sync();
+    dailyAverages_.sync();
+}
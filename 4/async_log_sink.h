@@ -0,0 +1,105 @@
+#pragma once
+
+#include "log_writer.h"
+#include "segmented_log.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class LogTarget {
+    AllReadings,
+    HourlyAverage,
+    DailyAverage
+};
+
+enum class OverflowPolicy {
+    Block,
+    DropNewest
+};
+
+struct AsyncLogOptions {
+    size_t queueCapacity;
+    OverflowPolicy overflow;
+    int syncIntervalMs;
+    FlushPolicy flush;
+    LogFormat format;
+};
+
+AsyncLogOptions defaultAsyncLogOptions(LogFormat format);
+
+// Single-producer queue in front of a writer thread that owns the segmented logs
+// once start() has been called; the producer must not touch them directly after that.
+class AsyncLogSink {
+public:
+    AsyncLogSink(SegmentedLog &allReadings, SegmentedLog &hourlyAverages, SegmentedLog &dailyAverages,
+                 const AsyncLogOptions &options);
+    ~AsyncLogSink();
+
+    void start();
+    void stop();
+
+    bool write(LogTarget target, time_t time, double value);
+    void expire(time_t now);
+    void flush();
+
+    void setFlushPolicy(const FlushPolicy &policy);
+    void setOverflowPolicy(OverflowPolicy policy);
+    unsigned long long getDropped() const;
+
+private:
+    enum class EntryKind {
+        Write,
+        Expire,
+        Flush,
+        Stop
+    };
+
+    static const size_t cacheLineSize = 64;
+
+    struct Entry {
+        EntryKind kind;
+        LogTarget target;
+        time_t time;
+        double value;
+    };
+
+    bool push(const Entry &entry, bool mayDrop);
+    bool pop(Entry &entry);
+    void run();
+    void writeEntry(const Entry &entry, const FlushPolicy &policy);
+    SegmentedLog &segmentsFor(LogTarget target);
+    void flushAll();
+    void syncAll();
+
+    SegmentedLog &allReadings_;
+    SegmentedLog &hourlyAverages_;
+    SegmentedLog &dailyAverages_;
+    LogFormat format_;
+    int syncIntervalMs_;
+
+    std::vector<Entry> ring_;
+    size_t mask_;
+    // Padding rather than alignas keeps head_ and tail_ on separate cache lines without
+    // over-aligning the sink, which C++11 operator new would not honour.
+    char headPad_[cacheLineSize];
+    std::atomic<size_t> head_;
+    char tailPad_[cacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+    char afterTailPad_[cacheLineSize - sizeof(std::atomic<size_t>)];
+    std::atomic<bool> consumerSleeping_;
+    std::atomic<int> overflow_;
+    std::atomic<unsigned long long> dropped_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeConsumer_;
+    std::condition_variable flushed_;
+    FlushPolicy flushPolicy_;
+    unsigned long long flushRequested_;
+    unsigned long long flushCompleted_;
+
+    std::thread thread_;
+};
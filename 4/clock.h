@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual time_t now() = 0;
+};
+
+class SystemClock : public Clock {
+public:
+    time_t now() override;
+};
+
+class ScaledClock : public Clock {
+public:
+    explicit ScaledClock(int scale);
+    time_t now() override;
+
+private:
+    std::chrono::system_clock::time_point startTime_;
+    int scale_;
+};
+
+class VirtualClock : public Clock {
+public:
+    VirtualClock(time_t startTime, time_t period);
+    time_t now() override;
+
+    time_t advance();
+    void set(time_t time);
+    time_t getPeriod() const;
+
+private:
+    time_t currentTime_;
+    time_t period_;
+};
@@ -0,0 +1,307 @@
+#include "compressed_log.h"
+#include "record_log.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char compressedLogMagic[4] = {'T', 'L', 'G', 'Z'};
+static const std::uint16_t compressedLogVersion = 1;
+static const size_t frameHeaderSize = 4;
+
+static bool isValidHeader(const RecordLogHeader &header) {
+    return std::memcmp(header.magic, compressedLogMagic, sizeof(compressedLogMagic)) == 0 &&
+           header.version == compressedLogVersion;
+}
+
+static std::uint32_t frameLength(const char *data) {
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(data);
+    return static_cast<std::uint32_t>(in[0]) | (static_cast<std::uint32_t>(in[1]) << 8) |
+           (static_cast<std::uint32_t>(in[2]) << 16) | (static_cast<std::uint32_t>(in[3]) << 24);
+}
+
+// Walks the frames and returns the offset just past the last complete, decodable one.
+static size_t validEnd(const char *data, size_t size, size_t *blocks) {
+    size_t offset = sizeof(RecordLogHeader);
+    size_t count = 0;
+    while (offset + frameHeaderSize <= size) {
+        std::uint32_t length = frameLength(data + offset);
+        CompressedBlockInfo info;
+        if (length > size - offset - frameHeaderSize ||
+            !readCompressedBlockInfo(data + offset + frameHeaderSize, length, info)) {
+            break;
+        }
+        offset += frameHeaderSize + length;
+        ++count;
+    }
+    if (blocks) {
+        *blocks = count;
+    }
+    return offset;
+}
+
+bool isCompressedLog(const std::string &fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    RecordLogHeader header;
+    bool compressed = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) && isValidHeader(header);
+    close(fd);
+    return compressed;
+}
+
+CompressedLogWriter::CompressedLogWriter(const std::string &fileName, size_t blockPoints)
+    : fileName_(fileName), fd_(-1), blockOffset_(0), blockPoints_(blockPoints), pending_(0) {
+}
+
+CompressedLogWriter::~CompressedLogWriter() {
+    closeFile();
+}
+
+bool CompressedLogWriter::openFile() {
+    if (fd_ != -1) {
+        return true;
+    }
+
+    fd_ = open(fileName_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        std::cerr << "Unable to open log file: " << fileName_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        std::cerr << "Unable to stat log file: " << fileName_ << ": " << strerror(errno) << std::endl;
+        closeFile();
+        return false;
+    }
+
+    if (st.st_size < static_cast<off_t>(sizeof(RecordLogHeader))) {
+        RecordLogHeader header = {};
+        std::memcpy(header.magic, compressedLogMagic, sizeof(compressedLogMagic));
+        header.version = compressedLogVersion;
+        if (pwrite(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            std::cerr << "Unable to write log header: " << fileName_ << ": " << strerror(errno) << std::endl;
+            closeFile();
+            return false;
+        }
+        blockOffset_ = sizeof(header);
+        return true;
+    }
+
+    std::string contents(static_cast<size_t>(st.st_size), '\0');
+    if (pread(fd_, &contents[0], contents.size(), 0) != static_cast<ssize_t>(contents.size()) ||
+        !isValidHeader(*reinterpret_cast<const RecordLogHeader *>(contents.data()))) {
+        std::cerr << "Not a compressed temperature log: " << fileName_ << std::endl;
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // A block torn by a crash is cut off so the next one starts on a frame boundary.
+    blockOffset_ = static_cast<off_t>(validEnd(contents.data(), contents.size(), nullptr));
+    if (blockOffset_ < st.st_size && ftruncate(fd_, blockOffset_) != 0) {
+        std::cerr << "Unable to truncate log file: " << fileName_ << ": " << strerror(errno) << std::endl;
+    }
+    return true;
+}
+
+void CompressedLogWriter::closeFile() {
+    if (fd_ == -1) {
+        return;
+    }
+    flush();
+    close(fd_);
+    fd_ = -1;
+}
+
+bool CompressedLogWriter::append(time_t time, double value) {
+    if (!openFile()) {
+        return false;
+    }
+
+    if (encoder_.size() >= blockPoints_ || (encoder_.size() > 0 && time < encoder_.lastTime())) {
+        if (!sealBlock()) {
+            return false;
+        }
+    }
+
+    if (pending_ == 0) {
+        oldestPending_ = std::chrono::steady_clock::now();
+    }
+    encoder_.append(time, value);
+    ++pending_;
+    return true;
+}
+
+bool CompressedLogWriter::flush() {
+    if (pending_ == 0 || fd_ == -1) {
+        return true;
+    }
+    return writeBlock();
+}
+
+bool CompressedLogWriter::flushIfDue(const FlushPolicy &policy) {
+    if (pending_ == 0) {
+        return true;
+    }
+    if (pending_ >= policy.maxLines) {
+        return flush();
+    }
+
+    auto age = std::chrono::steady_clock::now() - oldestPending_;
+    if (age >= std::chrono::milliseconds(policy.maxDelayMs)) {
+        return flush();
+    }
+    return true;
+}
+
+bool CompressedLogWriter::sync() {
+    if (!flush()) {
+        return false;
+    }
+    if (fd_ != -1 && fdatasync(fd_) != 0) {
+        std::cerr << "Error syncing log file " << fileName_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CompressedLogWriter::writeBlock() {
+    std::uint32_t length = static_cast<std::uint32_t>(encoder_.encodedSize());
+    frame_.clear();
+    for (int i = 0; i < 4; ++i) {
+        frame_.push_back(static_cast<char>(length >> (8 * i)));
+    }
+    encoder_.encode(frame_);
+
+    const char *data = frame_.data();
+    size_t remaining = frame_.size();
+    off_t offset = blockOffset_;
+    while (remaining > 0) {
+        ssize_t written = pwrite(fd_, data, remaining, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error writing log file " << fileName_ << ": " << strerror(errno) << std::endl;
+            pending_ = 0;
+            return false;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+        offset += written;
+    }
+
+    pending_ = 0;
+    return true;
+}
+
+bool CompressedLogWriter::sealBlock() {
+    bool written = pending_ == 0 || writeBlock();
+    blockOffset_ += static_cast<off_t>(frameHeaderSize + encoder_.encodedSize());
+    encoder_.clear();
+    return written;
+}
+
+CompressedLogReader::CompressedLogReader() : fd_(-1), mapping_(nullptr), mappingSize_(0) {
+}
+
+CompressedLogReader::~CompressedLogReader() {
+    closeFile();
+}
+
+bool CompressedLogReader::openFile(const std::string &fileName) {
+    closeFile();
+
+    fd_ = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ == -1) {
+        std::cerr << "Unable to open log file: " << fileName << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(RecordLogHeader))) {
+        std::cerr << "Not a compressed temperature log: " << fileName << std::endl;
+        closeFile();
+        return false;
+    }
+
+    mappingSize_ = static_cast<size_t>(st.st_size);
+    mapping_ = mmap(nullptr, mappingSize_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        std::cerr << "Unable to map log file: " << fileName << ": " << strerror(errno) << std::endl;
+        mapping_ = nullptr;
+        closeFile();
+        return false;
+    }
+
+    if (!isValidHeader(*static_cast<const RecordLogHeader *>(mapping_))) {
+        std::cerr << "Not a compressed temperature log: " << fileName << std::endl;
+        closeFile();
+        return false;
+    }
+    return true;
+}
+
+void CompressedLogReader::closeFile() {
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+    }
+    if (fd_ != -1) {
+        close(fd_);
+        fd_ = -1;
+    }
+    mappingSize_ = 0;
+}
+
+size_t CompressedLogReader::getBlockCount() const {
+    size_t blocks = 0;
+    if (mapping_) {
+        validEnd(static_cast<const char *>(mapping_), mappingSize_, &blocks);
+    }
+    return blocks;
+}
+
+size_t CompressedLogReader::getFileSize() const {
+    return mappingSize_;
+}
+
+void CompressedLogReader::read(time_t from, time_t to, ReadingSeries &series) const {
+    if (!mapping_) {
+        return;
+    }
+
+    const char *data = static_cast<const char *>(mapping_);
+    size_t offset = sizeof(RecordLogHeader);
+    while (offset + frameHeaderSize <= mappingSize_) {
+        std::uint32_t length = frameLength(data + offset);
+        const char *block = data + offset + frameHeaderSize;
+        CompressedBlockInfo info;
+        if (length > mappingSize_ - offset - frameHeaderSize || !readCompressedBlockInfo(block, length, info)) {
+            break;
+        }
+        offset += frameHeaderSize + length;
+        if (info.lastTime < from || info.firstTime >= to) {
+            continue;
+        }
+
+        BlockDecoder decoder(block, length);
+        time_t time;
+        double value;
+        while (decoder.next(time, value)) {
+            if (time >= to) {
+                break;
+            }
+            if (time >= from) {
+                series.push_back(std::make_pair(time, value));
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "compressed_block.h"
+#include "log_writer.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+
+// Segment file of length-prefixed compressed blocks after a 16-byte header. The open
+// block is rewritten in place on every flush and sealed once it holds blockPoints samples.
+class CompressedLogWriter {
+public:
+    explicit CompressedLogWriter(const std::string &fileName, size_t blockPoints = 1024);
+    ~CompressedLogWriter();
+
+    bool openFile();
+    void closeFile();
+
+    bool append(time_t time, double value);
+    bool flush();
+    bool flushIfDue(const FlushPolicy &policy);
+    bool sync();
+
+private:
+    bool writeBlock();
+    bool sealBlock();
+
+    std::string fileName_;
+    int fd_;
+    off_t blockOffset_;
+    BlockEncoder encoder_;
+    std::string frame_;
+    size_t blockPoints_;
+    size_t pending_;
+    std::chrono::steady_clock::time_point oldestPending_;
+};
+
+class CompressedLogReader {
+public:
+    CompressedLogReader();
+    ~CompressedLogReader();
+
+    bool openFile(const std::string &fileName);
+    void closeFile();
+
+    size_t getBlockCount() const;
+    size_t getFileSize() const;
+    void read(time_t from, time_t to, ReadingSeries &series) const;
+
+private:
+    int fd_;
+    void *mapping_;
+    size_t mappingSize_;
+};
+
+bool isCompressedLog(const std::string &fileName);
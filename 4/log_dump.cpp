@@ -0,0 +1,117 @@
+#include "compressed_log.h"
+#include "record_log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+static bool parseTime(const char *text, time_t &time) {
+    char *endptr = nullptr;
+    long long epoch = strtoll(text, &endptr, 10);
+    if (*endptr == '\0') {
+        time = static_cast<time_t>(epoch);
+        return true;
+    }
+
+    std::tm t = {};
+    const char *rest = strptime(text, "%Y-%m-%d %H:%M:%S", &t);
+    if (!rest) {
+        rest = strptime(text, "%Y-%m-%d", &t);
+    }
+    if (!rest || *rest != '\0') {
+        return false;
+    }
+    t.tm_isdst = -1;
+    time = mktime(&t);
+    return true;
+}
+
+static void printReading(time_t time, double value, const char *timeFormat, int precision) {
+    std::tm t;
+    localtime_r(&time, &t);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), timeFormat, &t);
+    std::printf("%s - %.*f\n", stamp, precision, value);
+}
+
+static void usage(const char *program) {
+    std::cerr << "Usage: " << program << " [--from TIME] [--to TIME] [--precision N] [--date] FILE..." << std::endl
+              << "TIME is a unix timestamp, \"YYYY-MM-DD HH:MM:SS\" or \"YYYY-MM-DD\" in local time." << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    time_t from = 0;
+    time_t to = 0;
+    bool hasTo = false;
+    int precision = 1;
+    bool dateOnly = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            if (!parseTime(argv[++i], from)) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            if (!parseTime(argv[++i], to)) {
+                usage(argv[0]);
+                return 1;
+            }
+            hasTo = true;
+        } else if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            precision = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--date") == 0) {
+            dateOnly = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *timeFormat = dateOnly ? "%Y-%m-%d" : "%Y-%m-%d %H:%M:%S";
+    int status = 0;
+    RecordLogReader reader;
+    for (const auto &file : files) {
+        if (isCompressedLog(file)) {
+            CompressedLogReader compressedReader;
+            if (!compressedReader.openFile(file)) {
+                status = 1;
+                continue;
+            }
+
+            ReadingSeries readings;
+            compressedReader.read(from, hasTo ? to : std::numeric_limits<time_t>::max(), readings);
+            for (const auto &reading : readings) {
+                printReading(reading.first, reading.second, timeFormat, precision);
+            }
+            continue;
+        }
+
+        if (!reader.openFile(file)) {
+            status = 1;
+            continue;
+        }
+
+        for (const LogRecord *record = reader.lowerBound(from); record != reader.end(); ++record) {
+            time_t time = static_cast<time_t>(record->time);
+            if (hasTo && time >= to) {
+                break;
+            }
+            printReading(time, static_cast<double>(record->value), timeFormat, precision);
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,155 @@
+#include "log_writer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+FlushPolicy defaultFlushPolicy() {
+    FlushPolicy policy;
+    policy.maxLines = 64;
+    policy.maxDelayMs = 1000;
+    policy.flushOnAggregate = true;
+    return policy;
+}
+
+LogWriter::LogWriter(const std::string &fileName, size_t bufferSize)
+    : fileName_(fileName), fd_(-1), capacity_(bufferSize), pendingLines_(0) {
+    buffer_.reserve(capacity_);
+}
+
+LogWriter::~LogWriter() {
+    closeFile();
+}
+
+bool LogWriter::openFile() {
+    if (fd_ != -1) {
+        return true;
+    }
+
+    fd_ = open(fileName_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        std::cerr << "Unable to open log file: " << fileName_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void LogWriter::closeFile() {
+    if (fd_ == -1) {
+        return;
+    }
+    flush();
+    close(fd_);
+    fd_ = -1;
+}
+
+bool LogWriter::isOpen() const {
+    return fd_ != -1;
+}
+
+bool LogWriter::append(const std::string &line) {
+    if (!openFile()) {
+        return false;
+    }
+
+    if (pendingLines_ == 0) {
+        oldestPending_ = std::chrono::steady_clock::now();
+    }
+
+    if (buffer_.size() + line.size() + 1 <= capacity_) {
+        buffer_.append(line);
+        buffer_.push_back('\n');
+        ++pendingLines_;
+        return true;
+    }
+
+    // The buffer is full: hand the kernel the buffered lines and the new one in a single call.
+    char newline = '\n';
+    iovec iov[3];
+    iov[0].iov_base = const_cast<char *>(buffer_.data());
+    iov[0].iov_len = buffer_.size();
+    iov[1].iov_base = const_cast<char *>(line.data());
+    iov[1].iov_len = line.size();
+    iov[2].iov_base = &newline;
+    iov[2].iov_len = 1;
+
+    bool ok = writeAll(iov, 3);
+    buffer_.clear();
+    pendingLines_ = 0;
+    return ok;
+}
+
+bool LogWriter::flush() {
+    if (buffer_.empty() || fd_ == -1) {
+        return true;
+    }
+
+    iovec iov;
+    iov.iov_base = const_cast<char *>(buffer_.data());
+    iov.iov_len = buffer_.size();
+
+    bool ok = writeAll(&iov, 1);
+    buffer_.clear();
+    pendingLines_ = 0;
+    return ok;
+}
+
+bool LogWriter::flushIfDue(const FlushPolicy &policy) {
+    if (pendingLines_ == 0) {
+        return true;
+    }
+    if (pendingLines_ >= policy.maxLines) {
+        return flush();
+    }
+
+    auto age = std::chrono::steady_clock::now() - oldestPending_;
+    if (age >= std::chrono::milliseconds(policy.maxDelayMs)) {
+        return flush();
+    }
+    return true;
+}
+
+bool LogWriter::sync() {
+    if (!flush()) {
+        return false;
+    }
+    if (fd_ != -1 && fdatasync(fd_) != 0) {
+        std::cerr << "Error syncing log file " << fileName_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+const std::string &LogWriter::getFileName() const {
+    return fileName_;
+}
+
+size_t LogWriter::getPendingLines() const {
+    return pendingLines_;
+}
+
+bool LogWriter::writeAll(iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd_, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error writing log file " << fileName_ << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        size_t remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    return true;
+}
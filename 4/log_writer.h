@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <sys/uio.h>
+
+struct FlushPolicy {
+    size_t maxLines;
+    int maxDelayMs;
+    bool flushOnAggregate;
+};
+
+FlushPolicy defaultFlushPolicy();
+
+class LogWriter {
+public:
+    explicit LogWriter(const std::string &fileName, size_t bufferSize = 64 * 1024);
+    ~LogWriter();
+
+    bool openFile();
+    void closeFile();
+    bool isOpen() const;
+
+    bool append(const std::string &line);
+    bool flush();
+    bool flushIfDue(const FlushPolicy &policy);
+    bool sync();
+
+    const std::string &getFileName() const;
+    size_t getPendingLines() const;
+
+private:
+    bool writeAll(iovec *iov, int count);
+
+    std::string fileName_;
+    int fd_;
+    std::string buffer_;
+    size_t capacity_;
+    size_t pendingLines_;
+    std::chrono::steady_clock::time_point oldestPending_;
+};
@@ -3,80 +3,186 @@
 #include <chrono>
 #include <cmath>
 #include <ctime>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 
-std::chrono::time_point<std::chrono::system_clock> programStartTime;
-bool isProgramStartTimeSet = false;
-
-time_t Logger::getCurrentTime() {
-    auto now = std::chrono::system_clock::now();
-    time_t currentTime = std::chrono::system_clock::to_time_t(now);
+static const time_t cleanupInterval = 60;
+static const time_t allReadingsRetention = 24 * 3600;
+static const time_t hourlyAverageRetention = 30 * 24 * 3600;
+static const time_t dailyAverageRetention = 365 * 24 * 3600;
+static const std::chrono::seconds snapshotInterval(60);
+static const time_t lateReadingWindow = 3600;
+
+#if defined(USE_COMPRESSED_LOG)
+static const LogFormat logFormat = LogFormat::Compressed;
+#elif defined(USE_BINARY_LOG)
+static const LogFormat logFormat = LogFormat::Binary;
+#else
+static const LogFormat logFormat = LogFormat::Text;
+#endif
 
+static Clock *createClock(int scale) {
 #ifdef USE_SIMULATION
-    if (!isProgramStartTimeSet) {
-        programStartTime = now;
-        isProgramStartTimeSet = true;
-    }
-
-    auto duration = now - programStartTime;
-    double timeDiff = std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
-    currentTime = static_cast<time_t>(std::chrono::system_clock::to_time_t(programStartTime) + timeDiff * simulationScale_);
-
+    return new ScaledClock(scale);
+#else
+    (void)scale;
+    return new SystemClock();
 #endif
+}
 
-    return currentTime;
+time_t Logger::getCurrentTime() {
+    return clock_->now();
 }
 
 Logger::Logger(const std::string &allReadingsLog, const std::string &hourlyAverageLog, const std::string &dailyAverageLog)
-    : allReadingsLog_(allReadingsLog), hourlyAverageLog_(hourlyAverageLog), dailyAverageLog_(dailyAverageLog), simulationScale_(1) {
+    : allReadingsSegments_(allReadingsLog, SegmentPeriod::Hour, allReadingsRetention, logFormat),
+      hourlyAverageSegments_(hourlyAverageLog, SegmentPeriod::Day, hourlyAverageRetention, logFormat),
+      dailyAverageSegments_(dailyAverageLog, SegmentPeriod::Month, dailyAverageRetention, logFormat),
+      sink_(allReadingsSegments_, hourlyAverageSegments_, dailyAverageSegments_, defaultAsyncLogOptions(logFormat)),
+      ownedClock_(createClock(1)), clock_(ownedClock_.get()), lastCleanupTime_(0), rejectedSamples_(0),
+      snapshotPath_(allReadingsLog + ".snapshot") {
+    restoreState();
+    sink_.start();
 }
 
 Logger::Logger(const std::string &allReadingsLog, const std::string &hourlyAverageLog, const std::string &dailyAverageLog, int scale)
-    : allReadingsLog_(allReadingsLog), hourlyAverageLog_(hourlyAverageLog), dailyAverageLog_(dailyAverageLog), simulationScale_(scale) {
+    : allReadingsSegments_(allReadingsLog, SegmentPeriod::Hour, allReadingsRetention, logFormat),
+      hourlyAverageSegments_(hourlyAverageLog, SegmentPeriod::Day, hourlyAverageRetention, logFormat),
+      dailyAverageSegments_(dailyAverageLog, SegmentPeriod::Month, dailyAverageRetention, logFormat),
+      sink_(allReadingsSegments_, hourlyAverageSegments_, dailyAverageSegments_, defaultAsyncLogOptions(logFormat)),
+      ownedClock_(createClock(scale)), clock_(ownedClock_.get()), lastCleanupTime_(0), rejectedSamples_(0),
+      snapshotPath_(allReadingsLog + ".snapshot") {
+    restoreState();
+    sink_.start();
+}
+
+Logger::Logger(const std::string &allReadingsLog, const std::string &hourlyAverageLog, const std::string &dailyAverageLog, Clock &clock)
+    : allReadingsSegments_(allReadingsLog, SegmentPeriod::Hour, allReadingsRetention, logFormat),
+      hourlyAverageSegments_(hourlyAverageLog, SegmentPeriod::Day, hourlyAverageRetention, logFormat),
+      dailyAverageSegments_(dailyAverageLog, SegmentPeriod::Month, dailyAverageRetention, logFormat),
+      sink_(allReadingsSegments_, hourlyAverageSegments_, dailyAverageSegments_, defaultAsyncLogOptions(logFormat)),
+      clock_(&clock), lastCleanupTime_(0), rejectedSamples_(0),
+      snapshotPath_(allReadingsLog + ".snapshot") {
+    restoreState();
+    sink_.start();
 }
 
 Logger::~Logger() {
+    saveSnapshot();
     cleanupLogs();
+    sink_.stop();
 }
 
 void Logger::logTemperature(const std::string &temperature) {
-    time_t currentTime = getCurrentTime();
-    try {
-        double tempValue = std::stod(temperature);
-        temperatureReadings_.push_back(std::make_pair(currentTime, tempValue));
+    double tempValue = 0.0;
+    ParseStatus status = parseTemperature(temperature, tempValue);
+    if (status != ParseStatus::Ok) {
+        rejectSample(status);
+        return;
+    }
+
+    logTemperature(tempValue);
+}
+
+void Logger::logTemperature(double temperature) {
+    Sample sample;
+    sample.sensorId = 0;
+    sample.timestamp = 0;
+    sample.value = temperature;
+    sample.quality = SampleQuality::Good;
+    logSample(sample);
+}
 
-        std::stringstream ss;
-        ss << std::put_time(localtime(&currentTime), "%Y-%m-%d %H:%M:%S") << " - " << temperature;
-        writeLog(allReadingsLog_, ss.str(), true);
-    } catch (std::invalid_argument &e) {
-        std::cerr << "Error converting temperature to double" << e.what() << std::endl;
-    } catch (std::out_of_range &e) {
-        std::cerr << "Error converting temperature to double" << e.what() << std::endl;
+void Logger::logSample(const Sample &sample) {
+    if (!std::isfinite(sample.value)) {
+        rejectSample(ParseStatus::OutOfRange);
+        return;
+    }
+
+    time_t time = sample.timestamp != 0 ? sample.timestamp : getCurrentTime();
+    temperatureReadings_.push_back(std::make_pair(time, sample.value));
+
+    sink_.write(LogTarget::AllReadings, time, sample.value);
+}
+
+unsigned long long Logger::getRejectedSamples() const {
+    return rejectedSamples_;
+}
+
+void Logger::rejectSample(ParseStatus status) {
+    ++rejectedSamples_;
+    if (rejectedSamples_ == 1 || rejectedSamples_ % 1000 == 0) {
+        std::cerr << "Error converting temperature to double: " << parseStatusMessage(status)
+                  << " (rejected samples: " << rejectedSamples_ << ")" << std::endl;
     }
 }
 
 void Logger::updateLogs() {
     calculateHourlyAverage();
     calculateDailyAverage();
-    cleanupLogs();
-}
 
-void Logger::writeLog(const std::string &fileName, const std::string &message, bool append) {
-    std::ofstream logFile;
-    if (append) {
-        logFile.open(fileName, std::ios::app);
-    } else {
-        logFile.open(fileName);
+    time_t now = getCurrentTime();
+    if (now - lastCleanupTime_ >= cleanupInterval) {
+        cleanupLogs();
+        lastCleanupTime_ = now;
     }
 
-    if (logFile.is_open()) {
-        logFile << message << std::endl;
-        logFile.close();
-    } else {
-        std::cerr << "Unable to open log file: " << fileName << std::endl;
+    if (std::chrono::steady_clock::now() - lastSnapshot_ >= snapshotInterval) {
+        saveSnapshot();
+    }
+}
+
+bool Logger::saveSnapshot() {
+    lastSnapshot_ = std::chrono::steady_clock::now();
+    return writeSnapshot(snapshotPath_, getCurrentTime(), temperatureReadings_, hourlyAverageReadings_, dailyAverageReadings_);
+}
+
+void Logger::restoreState() {
+    time_t now = getCurrentTime();
+    time_t readingsSince = now - allReadingsRetention;
+    time_t hourlySince = now - hourlyAverageRetention;
+    time_t dailySince = now - dailyAverageRetention;
+
+    LoggerSnapshot snapshot;
+    if (readSnapshot(snapshotPath_, snapshot)) {
+        temperatureReadings_ = std::move(snapshot.readings);
+        hourlyAverageReadings_ = std::move(snapshot.hourlyAverages);
+        dailyAverageReadings_ = std::move(snapshot.dailyAverages);
+        hourlySince = dailySince = snapshot.snapshotTime;
+        // A reading stamped before the snapshot but logged after it is only in the
+        // segments, so readings are merged from lateReadingWindow before the snapshot
+        // and the snapshot's own copies of that stretch are dropped. A reading logged
+        // more than lateReadingWindow after its timestamp, and after the last snapshot,
+        // is still on disk but not restored.
+        readingsSince = snapshot.snapshotTime - lateReadingWindow;
+        temperatureReadings_.erase(std::remove_if(temperatureReadings_.begin(), temperatureReadings_.end(),
+                                                  [readingsSince](const std::pair<time_t, double> &reading) {
+                                                      return reading.first >= readingsSince;
+                                                  }),
+                                   temperatureReadings_.end());
     }
+
+    allReadingsSegments_.readSince(readingsSince, temperatureReadings_);
+    hourlyAverageSegments_.readSince(hourlySince, hourlyAverageReadings_);
+    dailyAverageSegments_.readSince(dailySince, dailyAverageReadings_);
+
+    cleanupLogs();
+    lastSnapshot_ = std::chrono::steady_clock::now();
+}
+
+void Logger::setFlushPolicy(const FlushPolicy &policy) {
+    sink_.setFlushPolicy(policy);
+}
+
+void Logger::setOverflowPolicy(OverflowPolicy policy) {
+    sink_.setOverflowPolicy(policy);
+}
+
+unsigned long long Logger::getDroppedSamples() const {
+    return sink_.getDropped();
+}
+
+void Logger::flush() {
+    sink_.flush();
 }
 
 void Logger::calculateHourlyAverage() {
@@ -86,6 +192,9 @@ void Logger::calculateHourlyAverage() {
 
     time_t now = getCurrentTime();
     time_t currentHour = now - (now % 3600);
+    if (!hourlyAverageReadings_.empty() && hourlyAverageReadings_.back().first == currentHour) {
+        return;
+    }
 
     double sum = 0.0;
     int count = 0;
@@ -99,13 +208,9 @@ void Logger::calculateHourlyAverage() {
 
     if (count > 0) {
         double average = sum / count;
-        if (hourlyAverageReadings_.empty() || hourlyAverageReadings_.back().first != currentHour) {
-            hourlyAverageReadings_.push_back(std::make_pair(currentHour, average));
+        hourlyAverageReadings_.push_back(std::make_pair(currentHour, average));
 
-            std::stringstream ss;
-            ss << std::put_time(localtime(&currentHour), "%Y-%m-%d %H:%M:%S") << " - " << std::fixed << std::setprecision(2) << average;
-            writeLog(hourlyAverageLog_, ss.str(), true);
-        }
+        sink_.write(LogTarget::HourlyAverage, currentHour, average);
     }
 }
 
@@ -116,6 +221,9 @@ void Logger::calculateDailyAverage() {
 
     time_t now = getCurrentTime();
     time_t currentDay = now - (now % 86400);
+    if (!dailyAverageReadings_.empty() && dailyAverageReadings_.back().first == currentDay) {
+        return;
+    }
 
     double sum = 0.0;
     int count = 0;
@@ -129,104 +237,19 @@ void Logger::calculateDailyAverage() {
 
     if (count > 0) {
         double average = sum / count;
+        dailyAverageReadings_.push_back(std::make_pair(currentDay, average));
 
-        if (dailyAverageReadings_.empty() || dailyAverageReadings_.back().first != currentDay) {
-            dailyAverageReadings_.push_back(std::make_pair(currentDay, average));
-
-            std::stringstream ss;
-            ss << std::put_time(localtime(&currentDay), "%Y-%m-%d") << " - " << std::fixed << std::setprecision(2) << average;
-            writeLog(dailyAverageLog_, ss.str(), true);
-        }
+        sink_.write(LogTarget::DailyAverage, currentDay, average);
     }
 }
 
 void Logger::cleanupLogs() {
     time_t now = getCurrentTime();
-    time_t oneDayAgo = now - (24 * 3600);
-    time_t oneMonthAgo = now - (30 * 24 * 3600);
-    time_t oneYearAgo = now - (365 * 24 * 3600);
-
-    std::vector<std::string> allReadings;
-    std::ifstream allReadingsFile(allReadingsLog_);
-    if (allReadingsFile.is_open()) {
-        std::string line;
-        while (getline(allReadingsFile, line)) {
-            std::tm t{};
-            std::istringstream ss(line);
-            ss >> std::get_time(&t, "%Y-%m-%d %H:%M:%S");
-
-            if (ss.fail()) {
-                allReadings.push_back(line);
-                continue;
-            }
-
-            time_t fileTime = mktime(&t);
-            if (fileTime >= oneDayAgo) {
-                allReadings.push_back(line);
-            }
-        }
-        allReadingsFile.close();
-    }
-
-    std::ofstream allReadingsFileOut(allReadingsLog_);
-    for (const auto &line : allReadings) {
-        allReadingsFileOut << line << std::endl;
-    }
-    allReadingsFileOut.close();
+    sink_.expire(now);
 
-    std::vector<std::string> hourlyAverages;
-    std::ifstream hourlyAverageFile(hourlyAverageLog_);
-    if (hourlyAverageFile.is_open()) {
-        std::string line;
-        while (getline(hourlyAverageFile, line)) {
-            std::tm t{};
-            std::istringstream ss(line);
-            ss >> std::get_time(&t, "%Y-%m-%d %H:%M:%S");
-
-            if (ss.fail()) {
-                hourlyAverages.push_back(line);
-                continue;
-            }
-
-            time_t fileTime = mktime(&t);
-            if (fileTime >= oneMonthAgo) {
-                hourlyAverages.push_back(line);
-            }
-        }
-        hourlyAverageFile.close();
-    }
-
-    std::ofstream hourlyAverageFileOut(hourlyAverageLog_);
-    for (const auto &line : hourlyAverages) {
-        hourlyAverageFileOut << line << std::endl;
-    }
-    hourlyAverageFileOut.close();
-
-    std::vector<std::string> dailyAverages;
-    std::ifstream dailyAverageFile(dailyAverageLog_);
-    if (dailyAverageFile.is_open()) {
-        std::string line;
-        while (getline(dailyAverageFile, line)) {
-            std::tm t{};
-            std::istringstream ss(line);
-            ss >> std::get_time(&t, "%Y-%m-%d");
-            if (ss.fail()) {
-                dailyAverages.push_back(line);
-                continue;
-            }
-            time_t fileTime = mktime(&t);
-            if (fileTime >= oneYearAgo) {
-                dailyAverages.push_back(line);
-            }
-        }
-        dailyAverageFile.close();
-    }
-
-    std::ofstream dailyAverageFileOut(dailyAverageLog_);
-    for (const auto &line : dailyAverages) {
-        dailyAverageFileOut << line << std::endl;
-    }
-    dailyAverageFileOut.close();
+    time_t oneDayAgo = now - allReadingsRetention;
+    time_t oneMonthAgo = now - hourlyAverageRetention;
+    time_t oneYearAgo = now - dailyAverageRetention;
 
     while (!temperatureReadings_.empty() && temperatureReadings_.front().first < oneDayAgo) {
         temperatureReadings_.pop_front();
@@ -1,6 +1,13 @@
+#include "async_log_sink.h"
+#include "clock.h"
+#include "log_writer.h"
+#include "sample.h"
+#include "segmented_log.h"
+#include "temperature_parser.h"
+#include <chrono>
 #include <ctime>
 #include <deque>
-#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -8,23 +15,40 @@ class Logger {
 public:
     Logger(const std::string &allReadingsLog, const std::string &hourlyAverageLog, const std::string &dailyAverageLog, int scale);
     Logger(const std::string &allReadingsLog, const std::string &hourlyAverageLog, const std::string &dailyAverageLog);
+    Logger(const std::string &allReadingsLog, const std::string &hourlyAverageLog, const std::string &dailyAverageLog, Clock &clock);
     ~Logger();
     void logTemperature(const std::string &temperature);
+    void logTemperature(double temperature);
+    void logSample(const Sample &sample);
+    unsigned long long getRejectedSamples() const;
     void updateLogs();
+    void setFlushPolicy(const FlushPolicy &policy);
+    void setOverflowPolicy(OverflowPolicy policy);
+    unsigned long long getDroppedSamples() const;
+    void flush();
+    bool saveSnapshot();
 
 private:
-    std::string allReadingsLog_;
-    std::string hourlyAverageLog_;
-    std::string dailyAverageLog_;
+    SegmentedLog allReadingsSegments_;
+    SegmentedLog hourlyAverageSegments_;
+    SegmentedLog dailyAverageSegments_;
+    AsyncLogSink sink_;
     std::deque<std::pair<time_t, double>> temperatureReadings_;
     std::deque<std::pair<time_t, double>> hourlyAverageReadings_;
     std::deque<std::pair<time_t, double>> dailyAverageReadings_;
 
     time_t getCurrentTime();
-    void writeLog(const std::string &fileName, const std::string &message, bool append);
+    void rejectSample(ParseStatus status);
     void calculateHourlyAverage();
     void calculateDailyAverage();
     void cleanupLogs();
+    void restoreState();
 
-    int simulationScale_;
+    std::unique_ptr<Clock> ownedClock_;
+    Clock *clock_;
+    time_t lastCleanupTime_;
+    unsigned long long rejectedSamples_;
+
+    std::string snapshotPath_;
+    std::chrono::steady_clock::time_point lastSnapshot_;
 };
@@ -1,9 +1,13 @@
 #include "logger.h"
+#include "sample_parser.h"
 #include "serial_port.h"
 #include "temperature_sensor.h"
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <thread>
+#include <vector>
 
 int main(int argc, char *argv[]) {
     const std::string portName = "COM3";
@@ -11,7 +15,28 @@ int main(int argc, char *argv[]) {
     SerialPort serialPort(portName);
 
     int scale = 1;
-    if (argc > 1) {
+    long virtualPeriod = 0;
+    long virtualDuration = 0;
+    if (argc > 1 && std::strcmp(argv[1], "--virtual") == 0) {
+#ifdef USE_SIMULATION
+        char *endptr = nullptr;
+        virtualPeriod = argc > 2 ? strtol(argv[2], &endptr, 10) : 1;
+        if (argc > 2 && (*endptr != '\0' || virtualPeriod <= 0)) {
+            std::cerr << "Invalid sample period. Usage: " << argv[0] << " --virtual PERIOD_SECONDS [DURATION_SECONDS]" << std::endl;
+            return 1;
+        }
+        if (argc > 3) {
+            virtualDuration = strtol(argv[3], &endptr, 10);
+            if (*endptr != '\0' || virtualDuration < 0) {
+                std::cerr << "Invalid duration. Usage: " << argv[0] << " --virtual PERIOD_SECONDS [DURATION_SECONDS]" << std::endl;
+                return 1;
+            }
+        }
+#else
+        std::cerr << "Virtual clock mode requires a build with USE_SIMULATION" << std::endl;
+        return 1;
+#endif
+    } else if (argc > 1) {
         char* endptr;
         long parsedScale = strtol(argv[1], &endptr, 10);
 
@@ -24,13 +49,39 @@ int main(int argc, char *argv[]) {
 
     TemperatureSensor sensor;
 
-    Logger logger("all_readings.log", "hourly_average.log", "daily_average.log", scale);
+    std::unique_ptr<VirtualClock> virtualClock;
+    std::unique_ptr<Logger> loggerPtr;
+    if (virtualPeriod > 0) {
+        virtualClock.reset(new VirtualClock(time(nullptr), virtualPeriod));
+        loggerPtr.reset(new Logger("all_readings.log", "hourly_average.log", "daily_average.log", *virtualClock));
+        loggerPtr->setOverflowPolicy(OverflowPolicy::Block);
+    } else {
+        loggerPtr.reset(new Logger("all_readings.log", "hourly_average.log", "daily_average.log", scale));
+    }
+    Logger &logger = *loggerPtr;
+
+    SampleParser parser;
+    std::vector<Sample> samples;
+
+#ifdef USE_SIMULATION
+    time_t virtualEnd = virtualClock ? virtualClock->now() + virtualDuration : 0;
+#endif
+    unsigned long long virtualSamples = 0;
+    auto wallStart = std::chrono::steady_clock::now();
 
     while (true) {
-        std::string temperature;
+        samples.clear();
 
 #ifdef USE_SIMULATION
-        temperature = sensor.getTemperature();
+        if (virtualClock) {
+            if (virtualDuration > 0 && virtualClock->now() >= virtualEnd) {
+                break;
+            }
+            samples.push_back(sensor.getSample(virtualClock->advance()));
+            ++virtualSamples;
+        } else {
+            samples.push_back(sensor.getSample());
+        }
 #else
         if (!serialPort.isOpen()) {
             if (!serialPort.openPort()) {
@@ -42,18 +93,23 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        temperature = serialPort.readData();
-
-        if (temperature.empty()) {
+        if (parser.feed(serialPort.readData(), samples) == 0) {
             continue;
         }
 #endif
 
-        logger.logTemperature(temperature);
+        for (const auto &sample : samples) {
+            logger.logSample(sample);
+        }
 
         logger.updateLogs();
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!virtualClock) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
     }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    std::cout << "Simulated " << virtualDuration << " s with " << virtualSamples << " samples in " << wallSeconds << " s" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
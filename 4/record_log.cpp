@@ -0,0 +1,228 @@
+#include "record_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char recordLogMagic[4] = {'T', 'L', 'O', 'G'};
+static const std::uint16_t recordLogVersion = 1;
+
+static bool isValidHeader(const RecordLogHeader &header) {
+    return std::memcmp(header.magic, recordLogMagic, sizeof(recordLogMagic)) == 0 && header.version == recordLogVersion &&
+           header.recordSize == sizeof(LogRecord);
+}
+
+RecordLogWriter::RecordLogWriter(const std::string &fileName, size_t bufferRecords)
+    : fileName_(fileName), fd_(-1), nextOffset_(0), capacity_(bufferRecords) {
+    buffer_.reserve(capacity_);
+}
+
+RecordLogWriter::~RecordLogWriter() {
+    closeFile();
+}
+
+bool RecordLogWriter::openFile() {
+    if (fd_ != -1) {
+        return true;
+    }
+
+    fd_ = open(fileName_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        std::cerr << "Unable to open log file: " << fileName_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        std::cerr << "Unable to stat log file: " << fileName_ << ": " << strerror(errno) << std::endl;
+        closeFile();
+        return false;
+    }
+
+    if (st.st_size < static_cast<off_t>(sizeof(RecordLogHeader))) {
+        RecordLogHeader header = {};
+        std::memcpy(header.magic, recordLogMagic, sizeof(recordLogMagic));
+        header.version = recordLogVersion;
+        header.recordSize = sizeof(LogRecord);
+        if (pwrite(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            std::cerr << "Unable to write log header: " << fileName_ << ": " << strerror(errno) << std::endl;
+            closeFile();
+            return false;
+        }
+        nextOffset_ = sizeof(header);
+        return true;
+    }
+
+    RecordLogHeader header;
+    if (pread(fd_, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) || !isValidHeader(header)) {
+        std::cerr << "Not a temperature record log: " << fileName_ << std::endl;
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    // A torn record left by a crash is overwritten by the next append.
+    off_t records = (st.st_size - static_cast<off_t>(sizeof(header))) / static_cast<off_t>(sizeof(LogRecord));
+    nextOffset_ = static_cast<off_t>(sizeof(header)) + records * static_cast<off_t>(sizeof(LogRecord));
+    return true;
+}
+
+void RecordLogWriter::closeFile() {
+    if (fd_ == -1) {
+        return;
+    }
+    flush();
+    close(fd_);
+    fd_ = -1;
+}
+
+bool RecordLogWriter::append(time_t time, double value) {
+    if (!openFile()) {
+        return false;
+    }
+
+    if (buffer_.empty()) {
+        oldestPending_ = std::chrono::steady_clock::now();
+    }
+
+    LogRecord record;
+    record.time = static_cast<std::int64_t>(time);
+    record.value = static_cast<float>(value);
+    buffer_.push_back(record);
+
+    if (buffer_.size() >= capacity_) {
+        return flush();
+    }
+    return true;
+}
+
+bool RecordLogWriter::flush() {
+    if (buffer_.empty() || fd_ == -1) {
+        return true;
+    }
+
+    const char *data = reinterpret_cast<const char *>(buffer_.data());
+    size_t remaining = buffer_.size() * sizeof(LogRecord);
+    while (remaining > 0) {
+        ssize_t written = pwrite(fd_, data, remaining, nextOffset_);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error writing log file " << fileName_ << ": " << strerror(errno) << std::endl;
+            buffer_.clear();
+            return false;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+        nextOffset_ += written;
+    }
+
+    buffer_.clear();
+    return true;
+}
+
+bool RecordLogWriter::flushIfDue(const FlushPolicy &policy) {
+    if (buffer_.empty()) {
+        return true;
+    }
+    if (buffer_.size() >= policy.maxLines) {
+        return flush();
+    }
+
+    auto age = std::chrono::steady_clock::now() - oldestPending_;
+    if (age >= std::chrono::milliseconds(policy.maxDelayMs)) {
+        return flush();
+    }
+    return true;
+}
+
+bool RecordLogWriter::sync() {
+    if (!flush()) {
+        return false;
+    }
+    if (fd_ != -1 && fdatasync(fd_) != 0) {
+        std::cerr << "Error syncing log file " << fileName_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+RecordLogReader::RecordLogReader() : fd_(-1), mapping_(nullptr), mappingSize_(0), records_(nullptr), count_(0) {
+}
+
+RecordLogReader::~RecordLogReader() {
+    closeFile();
+}
+
+bool RecordLogReader::openFile(const std::string &fileName) {
+    closeFile();
+
+    fd_ = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ == -1) {
+        std::cerr << "Unable to open log file: " << fileName << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(RecordLogHeader))) {
+        std::cerr << "Not a temperature record log: " << fileName << std::endl;
+        closeFile();
+        return false;
+    }
+
+    mappingSize_ = static_cast<size_t>(st.st_size);
+    mapping_ = mmap(nullptr, mappingSize_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        std::cerr << "Unable to map log file: " << fileName << ": " << strerror(errno) << std::endl;
+        mapping_ = nullptr;
+        closeFile();
+        return false;
+    }
+
+    const RecordLogHeader *header = static_cast<const RecordLogHeader *>(mapping_);
+    if (!isValidHeader(*header)) {
+        std::cerr << "Not a temperature record log: " << fileName << std::endl;
+        closeFile();
+        return false;
+    }
+
+    records_ = reinterpret_cast<const LogRecord *>(static_cast<const char *>(mapping_) + sizeof(RecordLogHeader));
+    count_ = (mappingSize_ - sizeof(RecordLogHeader)) / sizeof(LogRecord);
+    return true;
+}
+
+void RecordLogReader::closeFile() {
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+        mapping_ = nullptr;
+    }
+    if (fd_ != -1) {
+        close(fd_);
+        fd_ = -1;
+    }
+    mappingSize_ = 0;
+    records_ = nullptr;
+    count_ = 0;
+}
+
+size_t RecordLogReader::size() const {
+    return count_;
+}
+
+const LogRecord *RecordLogReader::begin() const {
+    return records_;
+}
+
+const LogRecord *RecordLogReader::end() const {
+    return records_ + count_;
+}
+
+const LogRecord *RecordLogReader::lowerBound(time_t time) const {
+    return std::lower_bound(begin(), end(), static_cast<std::int64_t>(time),
+                            [](const LogRecord &record, std::int64_t value) { return record.time < value; });
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "log_writer.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#pragma pack(push, 1)
+struct LogRecord {
+    std::int64_t time;
+    float value;
+};
+
+struct RecordLogHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t recordSize;
+    std::uint64_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(LogRecord) == 12, "LogRecord must stay 12 bytes on disk");
+static_assert(sizeof(RecordLogHeader) == 16, "RecordLogHeader must stay 16 bytes on disk");
+
+class RecordLogWriter {
+public:
+    explicit RecordLogWriter(const std::string &fileName, size_t bufferRecords = 4096);
+    ~RecordLogWriter();
+
+    bool openFile();
+    void closeFile();
+
+    bool append(time_t time, double value);
+    bool flush();
+    bool flushIfDue(const FlushPolicy &policy);
+    bool sync();
+
+private:
+    std::string fileName_;
+    int fd_;
+    off_t nextOffset_;
+    std::vector<LogRecord> buffer_;
+    size_t capacity_;
+    std::chrono::steady_clock::time_point oldestPending_;
+};
+
+class RecordLogReader {
+public:
+    RecordLogReader();
+    ~RecordLogReader();
+
+    bool openFile(const std::string &fileName);
+    void closeFile();
+
+    size_t size() const;
+    const LogRecord *begin() const;
+    const LogRecord *end() const;
+    const LogRecord *lowerBound(time_t time) const;
+
+private:
+    int fd_;
+    void *mapping_;
+    size_t mappingSize_;
+    const LogRecord *records_;
+    size_t count_;
+};
@@ -0,0 +1,312 @@
+#include "segmented_log.h"
+#include "temperature_parser.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <unistd.h>
+
+time_t segmentStart(time_t time, SegmentPeriod period) {
+    switch (period) {
+    case SegmentPeriod::Hour:
+        return time - (time % 3600);
+    case SegmentPeriod::Day:
+        return time - (time % 86400);
+    case SegmentPeriod::Month: {
+        std::tm t;
+        gmtime_r(&time, &t);
+        t.tm_mday = 1;
+        t.tm_hour = 0;
+        t.tm_min = 0;
+        t.tm_sec = 0;
+        return timegm(&t);
+    }
+    }
+    return time;
+}
+
+time_t segmentEnd(time_t start, SegmentPeriod period) {
+    switch (period) {
+    case SegmentPeriod::Hour:
+        return start + 3600;
+    case SegmentPeriod::Day:
+        return start + 86400;
+    case SegmentPeriod::Month: {
+        std::tm t;
+        gmtime_r(&start, &t);
+        t.tm_mon += 1;
+        return timegm(&t);
+    }
+    }
+    return start;
+}
+
+SegmentedLog::SegmentedLog(const std::string &baseName, SegmentPeriod period, time_t retention, LogFormat format)
+    : period_(period), retention_(retention), format_(format), activeStart_(-1) {
+    std::string::size_type slash = baseName.rfind('/');
+    std::string fileName = baseName;
+    if (slash != std::string::npos) {
+        directory_ = baseName.substr(0, slash + 1);
+        fileName = baseName.substr(slash + 1);
+    }
+
+    std::string::size_type dot = fileName.rfind('.');
+    if (dot != std::string::npos && dot != 0) {
+        prefix_ = fileName.substr(0, dot) + ".";
+        suffix_ = fileName.substr(dot);
+    } else {
+        prefix_ = fileName + ".";
+        suffix_ = "";
+    }
+    if (format_ == LogFormat::Binary) {
+        suffix_ = ".bin";
+    } else if (format_ == LogFormat::Compressed) {
+        suffix_ = ".tsz";
+    }
+
+    discoverSegments();
+}
+
+bool SegmentedLog::append(time_t time, const std::string &line) {
+    if (!ensureSegment(time) || !writer_) {
+        return false;
+    }
+    return writer_->append(line);
+}
+
+bool SegmentedLog::appendRecord(time_t time, double value) {
+    if (!ensureSegment(time)) {
+        return false;
+    }
+    if (compressedWriter_) {
+        return compressedWriter_->append(time, value);
+    }
+    return recordWriter_ ? recordWriter_->append(time, value) : false;
+}
+
+bool SegmentedLog::flush() {
+    if (compressedWriter_) {
+        return compressedWriter_->flush();
+    }
+    if (recordWriter_) {
+        return recordWriter_->flush();
+    }
+    return writer_ ? writer_->flush() : true;
+}
+
+bool SegmentedLog::flushIfDue(const FlushPolicy &policy) {
+    if (compressedWriter_) {
+        return compressedWriter_->flushIfDue(policy);
+    }
+    if (recordWriter_) {
+        return recordWriter_->flushIfDue(policy);
+    }
+    return writer_ ? writer_->flushIfDue(policy) : true;
+}
+
+bool SegmentedLog::sync() {
+    if (compressedWriter_) {
+        return compressedWriter_->sync();
+    }
+    if (recordWriter_) {
+        return recordWriter_->sync();
+    }
+    return writer_ ? writer_->sync() : true;
+}
+
+size_t SegmentedLog::removeExpired(time_t now) {
+    time_t cutoff = now - retention_;
+    size_t removed = 0;
+
+    while (!segments_.empty() && segmentEnd(segments_.front(), period_) <= cutoff) {
+        time_t start = segments_.front();
+        if (start == activeStart_) {
+            writer_.reset();
+            recordWriter_.reset();
+            compressedWriter_.reset();
+            activeStart_ = -1;
+        }
+
+        std::string path = getSegmentPath(start);
+        if (unlink(path.c_str()) != 0 && errno != ENOENT) {
+            std::cerr << "Unable to remove log segment " << path << ": " << strerror(errno) << std::endl;
+            break;
+        }
+        segments_.pop_front();
+        ++removed;
+    }
+
+    return removed;
+}
+
+void SegmentedLog::readSince(time_t since, ReadingSeries &series) {
+    flush();
+
+    for (time_t start : segments_) {
+        if (segmentEnd(start, period_) <= since) {
+            continue;
+        }
+
+        std::string path = getSegmentPath(start);
+        if (format_ == LogFormat::Compressed) {
+            CompressedLogReader reader;
+            if (reader.openFile(path)) {
+                reader.read(since, std::numeric_limits<time_t>::max(), series);
+            }
+            continue;
+        }
+        if (format_ == LogFormat::Binary) {
+            RecordLogReader reader;
+            if (!reader.openFile(path)) {
+                continue;
+            }
+            for (const LogRecord *record = reader.lowerBound(since); record != reader.end(); ++record) {
+                series.push_back(std::make_pair(static_cast<time_t>(record->time), static_cast<double>(record->value)));
+            }
+            continue;
+        }
+
+        std::ifstream file(path);
+        std::string line;
+        while (getline(file, line)) {
+            time_t time;
+            double value;
+            if (parseTextLine(line, time, value) && time >= since) {
+                series.push_back(std::make_pair(time, value));
+            }
+        }
+    }
+}
+
+bool SegmentedLog::parseTextLine(const std::string &line, time_t &time, double &value) {
+    std::tm t = {};
+    int consumed = 0;
+    if (std::sscanf(line.c_str(), "%4d-%2d-%2d %2d:%2d:%2d - %n", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &t.tm_min,
+                    &t.tm_sec, &consumed) != 6 || consumed == 0) {
+        t = std::tm();
+        consumed = 0;
+        if (std::sscanf(line.c_str(), "%4d-%2d-%2d - %n", &t.tm_year, &t.tm_mon, &t.tm_mday, &consumed) != 3 || consumed == 0) {
+            return false;
+        }
+    }
+
+    if (parseTemperature(line.data() + consumed, line.data() + line.size(), value) != ParseStatus::Ok) {
+        return false;
+    }
+
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_isdst = -1;
+    time = mktime(&t);
+    return true;
+}
+
+std::string SegmentedLog::getSegmentPath(time_t start) const {
+    const char *format = "%Y-%m-%dT%H";
+    if (period_ == SegmentPeriod::Day) {
+        format = "%Y-%m-%d";
+    } else if (period_ == SegmentPeriod::Month) {
+        format = "%Y-%m";
+    }
+
+    std::tm t;
+    gmtime_r(&start, &t);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), format, &t);
+    return directory_ + prefix_ + stamp + suffix_;
+}
+
+size_t SegmentedLog::getSegmentCount() const {
+    return segments_.size();
+}
+
+void SegmentedLog::discoverSegments() {
+    DIR *dir = opendir(directory_.empty() ? "." : directory_.c_str());
+    if (!dir) {
+        return;
+    }
+
+    while (struct dirent *entry = readdir(dir)) {
+        time_t start;
+        if (parseSegmentName(entry->d_name, start)) {
+            segments_.push_back(start);
+        }
+    }
+    closedir(dir);
+
+    std::sort(segments_.begin(), segments_.end());
+}
+
+bool SegmentedLog::parseSegmentName(const std::string &name, time_t &start) const {
+    if (name.size() <= prefix_.size() + suffix_.size() || name.compare(0, prefix_.size(), prefix_) != 0 ||
+        name.compare(name.size() - suffix_.size(), suffix_.size(), suffix_) != 0) {
+        return false;
+    }
+
+    std::string stamp = name.substr(prefix_.size(), name.size() - prefix_.size() - suffix_.size());
+    std::tm t = {};
+    t.tm_mday = 1;
+    int consumed = 0;
+    bool parsed = false;
+    if (period_ == SegmentPeriod::Hour) {
+        parsed = std::sscanf(stamp.c_str(), "%4d-%2d-%2dT%2d%n", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour, &consumed) == 4;
+    } else if (period_ == SegmentPeriod::Day) {
+        parsed = std::sscanf(stamp.c_str(), "%4d-%2d-%2d%n", &t.tm_year, &t.tm_mon, &t.tm_mday, &consumed) == 3;
+    } else {
+        parsed = std::sscanf(stamp.c_str(), "%4d-%2d%n", &t.tm_year, &t.tm_mon, &consumed) == 2;
+    }
+    if (!parsed || static_cast<size_t>(consumed) != stamp.size()) {
+        return false;
+    }
+
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    start = timegm(&t);
+    return true;
+}
+
+bool SegmentedLog::ensureSegment(time_t time) {
+    time_t start = segmentStart(time, period_);
+    if (activeStart_ != -1 && start <= activeStart_) {
+        return true;
+    }
+    return rotate(start);
+}
+
+bool SegmentedLog::rotate(time_t start) {
+    writer_.reset();
+    recordWriter_.reset();
+    compressedWriter_.reset();
+    activeStart_ = -1;
+
+    std::string path = getSegmentPath(start);
+    if (format_ == LogFormat::Compressed) {
+        std::unique_ptr<CompressedLogWriter> writer(new CompressedLogWriter(path));
+        if (!writer->openFile()) {
+            return false;
+        }
+        compressedWriter_ = std::move(writer);
+    } else if (format_ == LogFormat::Binary) {
+        std::unique_ptr<RecordLogWriter> writer(new RecordLogWriter(path));
+        if (!writer->openFile()) {
+            return false;
+        }
+        recordWriter_ = std::move(writer);
+    } else {
+        std::unique_ptr<LogWriter> writer(new LogWriter(path));
+        if (!writer->openFile()) {
+            return false;
+        }
+        writer_ = std::move(writer);
+    }
+
+    activeStart_ = start;
+    if (segments_.empty() || segments_.back() < start) {
+        segments_.push_back(start);
+    }
+    return true;
+}
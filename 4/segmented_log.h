@@ -0,0 +1,61 @@
+#pragma once
+
+#include "compressed_log.h"
+#include "log_writer.h"
+#include "record_log.h"
+#include "snapshot.h"
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <string>
+
+enum class SegmentPeriod {
+    Hour,
+    Day,
+    Month
+};
+
+enum class LogFormat {
+    Text,
+    Binary,
+    Compressed
+};
+
+time_t segmentStart(time_t time, SegmentPeriod period);
+time_t segmentEnd(time_t start, SegmentPeriod period);
+
+class SegmentedLog {
+public:
+    SegmentedLog(const std::string &baseName, SegmentPeriod period, time_t retention, LogFormat format = LogFormat::Text);
+
+    bool append(time_t time, const std::string &line);
+    bool appendRecord(time_t time, double value);
+    bool flush();
+    bool flushIfDue(const FlushPolicy &policy);
+    bool sync();
+    size_t removeExpired(time_t now);
+    void readSince(time_t since, ReadingSeries &series);
+
+    std::string getSegmentPath(time_t start) const;
+    size_t getSegmentCount() const;
+
+private:
+    void discoverSegments();
+    bool parseSegmentName(const std::string &name, time_t &start) const;
+    static bool parseTextLine(const std::string &line, time_t &time, double &value);
+    bool ensureSegment(time_t time);
+    bool rotate(time_t start);
+
+    std::string directory_;
+    std::string prefix_;
+    std::string suffix_;
+    SegmentPeriod period_;
+    time_t retention_;
+    LogFormat format_;
+
+    time_t activeStart_;
+    std::unique_ptr<LogWriter> writer_;
+    std::unique_ptr<RecordLogWriter> recordWriter_;
+    std::unique_ptr<CompressedLogWriter> compressedWriter_;
+    std::deque<time_t> segments_;
+};
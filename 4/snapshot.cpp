@@ -0,0 +1,140 @@
+#include "snapshot.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static const char snapshotMagic[4] = {'T', 'S', 'N', 'P'};
+static const std::uint32_t snapshotVersion = 1;
+
+struct SnapshotHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::int64_t snapshotTime;
+    std::uint64_t counts[3];
+};
+
+struct SnapshotEntry {
+    std::int64_t time;
+    double value;
+};
+
+static std::uint64_t appendSeries(std::vector<SnapshotEntry> &entries, const ReadingSeries &series, time_t snapshotTime) {
+    std::uint64_t count = 0;
+    for (const auto &item : series) {
+        if (item.first >= snapshotTime) {
+            break;
+        }
+        SnapshotEntry entry;
+        entry.time = static_cast<std::int64_t>(item.first);
+        entry.value = item.second;
+        entries.push_back(entry);
+        ++count;
+    }
+    return count;
+}
+
+bool writeSnapshot(const std::string &path, time_t snapshotTime, const ReadingSeries &readings,
+                   const ReadingSeries &hourlyAverages, const ReadingSeries &dailyAverages) {
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.snapshotTime = static_cast<std::int64_t>(snapshotTime);
+
+    // Only entries strictly older than snapshotTime are stored, so recovery can
+    // load everything at or after snapshotTime from the primary storage without duplicates.
+    std::vector<SnapshotEntry> entries;
+    entries.reserve(readings.size() + hourlyAverages.size() + dailyAverages.size());
+    header.counts[0] = appendSeries(entries, readings, snapshotTime);
+    header.counts[1] = appendSeries(entries, hourlyAverages, snapshotTime);
+    header.counts[2] = appendSeries(entries, dailyAverages, snapshotTime);
+
+    std::string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "Unable to write snapshot " << tmpPath << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    const char *chunks[2] = {reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(entries.data())};
+    size_t sizes[2] = {sizeof(header), entries.size() * sizeof(SnapshotEntry)};
+    for (int i = 0; i < 2; ++i) {
+        size_t offset = 0;
+        while (offset < sizes[i]) {
+            ssize_t written = write(fd, chunks[i] + offset, sizes[i] - offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Unable to write snapshot " << tmpPath << ": " << strerror(errno) << std::endl;
+                close(fd);
+                unlink(tmpPath.c_str());
+                return false;
+            }
+            offset += static_cast<size_t>(written);
+        }
+    }
+
+    if (fdatasync(fd) != 0 || close(fd) != 0 || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Unable to store snapshot " << path << ": " << strerror(errno) << std::endl;
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSnapshot(const std::string &path, LoggerSnapshot &snapshot) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+    SnapshotHeader header;
+    if (fstat(fd, &st) != 0 || read(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header)) ||
+        std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 || header.version != snapshotVersion) {
+        std::cerr << "Ignoring invalid snapshot " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    std::uint64_t total = header.counts[0] + header.counts[1] + header.counts[2];
+    if (static_cast<std::uint64_t>(st.st_size) != sizeof(header) + total * sizeof(SnapshotEntry)) {
+        std::cerr << "Ignoring truncated snapshot " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    std::vector<SnapshotEntry> entries(total);
+    size_t size = entries.size() * sizeof(SnapshotEntry);
+    size_t offset = 0;
+    while (offset < size) {
+        ssize_t got = read(fd, reinterpret_cast<char *>(entries.data()) + offset, size - offset);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Unable to read snapshot " << path << std::endl;
+            close(fd);
+            return false;
+        }
+        offset += static_cast<size_t>(got);
+    }
+    close(fd);
+
+    ReadingSeries *series[3] = {&snapshot.readings, &snapshot.hourlyAverages, &snapshot.dailyAverages};
+    size_t index = 0;
+    for (int i = 0; i < 3; ++i) {
+        series[i]->clear();
+        for (std::uint64_t n = 0; n < header.counts[i]; ++n, ++index) {
+            series[i]->push_back(std::make_pair(static_cast<time_t>(entries[index].time), entries[index].value));
+        }
+    }
+    snapshot.snapshotTime = static_cast<time_t>(header.snapshotTime);
+    return true;
+}
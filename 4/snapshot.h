@@ -0,0 +1,19 @@
+#pragma once
+
+#include <ctime>
+#include <deque>
+#include <string>
+#include <utility>
+
+typedef std::deque<std::pair<time_t, double>> ReadingSeries;
+
+struct LoggerSnapshot {
+    time_t snapshotTime;
+    ReadingSeries readings;
+    ReadingSeries hourlyAverages;
+    ReadingSeries dailyAverages;
+};
+
+bool writeSnapshot(const std::string &path, time_t snapshotTime, const ReadingSeries &readings,
+                   const ReadingSeries &hourlyAverages, const ReadingSeries &dailyAverages);
+bool readSnapshot(const std::string &path, LoggerSnapshot &snapshot);
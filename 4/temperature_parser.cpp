@@ -0,0 +1,85 @@
+#include "temperature_parser.h"
+#include <cstdint>
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+ParseStatus parseTemperature(const char *begin, const char *end, double &value) {
+    static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                         1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    const int maxDigits = 18;
+
+    while (begin != end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end != begin && isSpace(*(end - 1))) {
+        --end;
+    }
+    if (begin == end) {
+        return ParseStatus::Empty;
+    }
+
+    bool negative = false;
+    if (*begin == '-' || *begin == '+') {
+        negative = *begin == '-';
+        ++begin;
+    }
+
+    std::uint64_t mantissa = 0;
+    int significantDigits = 0;
+    int fractionDigits = 0;
+    bool seenDigit = false;
+    bool seenPoint = false;
+
+    for (const char *p = begin; p != end; ++p) {
+        if (*p == '.' && !seenPoint) {
+            seenPoint = true;
+            continue;
+        }
+        if (*p < '0' || *p > '9') {
+            return ParseStatus::InvalidCharacter;
+        }
+
+        int digit = *p - '0';
+        seenDigit = true;
+        if (seenPoint) {
+            if (fractionDigits == maxDigits) {
+                continue;
+            }
+            ++fractionDigits;
+        }
+        if ((mantissa != 0 || digit != 0) && ++significantDigits > maxDigits) {
+            return ParseStatus::OutOfRange;
+        }
+        mantissa = mantissa * 10 + static_cast<std::uint64_t>(digit);
+    }
+
+    if (!seenDigit) {
+        return ParseStatus::InvalidCharacter;
+    }
+
+    value = static_cast<double>(mantissa) / powersOfTen[fractionDigits];
+    if (negative) {
+        value = -value;
+    }
+    return ParseStatus::Ok;
+}
+
+ParseStatus parseTemperature(const std::string &text, double &value) {
+    return parseTemperature(text.data(), text.data() + text.size(), value);
+}
+
+const char *parseStatusMessage(ParseStatus status) {
+    switch (status) {
+    case ParseStatus::Ok:
+        return "ok";
+    case ParseStatus::Empty:
+        return "empty input";
+    case ParseStatus::InvalidCharacter:
+        return "invalid character";
+    case ParseStatus::OutOfRange:
+        return "value out of range";
+    }
+    return "unknown error";
+}
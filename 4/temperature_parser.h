@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+enum class ParseStatus {
+    Ok,
+    Empty,
+    InvalidCharacter,
+    OutOfRange
+};
+
+ParseStatus parseTemperature(const char *begin, const char *end, double &value);
+ParseStatus parseTemperature(const std::string &text, double &value);
+const char *parseStatusMessage(ParseStatus status);
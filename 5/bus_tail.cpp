@@ -0,0 +1,75 @@
+#include "sample_bus.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    std::string name = "/temperature_monitor";
+    bool fromOldest = false;
+    bool quiet = false;
+    unsigned long long limit = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (std::strcmp(argv[i], "--from-oldest") == 0) {
+            fromOldest = true;
+        } else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            limit = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--name /SHM_NAME] [--from-oldest] [--count N] [--quiet]" << std::endl;
+            return 1;
+        }
+    }
+
+    SampleBusReader reader;
+    while (!reader.open(name, fromOldest) || !reader.isWriterAlive()) {
+        std::cerr << "Waiting for sample bus " << name << "..." << std::endl;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    std::vector<Sample> samples(4096);
+    unsigned long long received = 0;
+    unsigned long long reportedLost = 0;
+    unsigned long long lostOnEarlierBuses = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (limit == 0 || received < limit) {
+        size_t count = reader.read(samples.data(), samples.size());
+        if (reader.getLostSamples() != reportedLost) {
+            std::fprintf(stderr, "overrun: lost %llu samples\n", reader.getLostSamples() - reportedLost);
+            reportedLost = reader.getLostSamples();
+        }
+        if (count == 0) {
+            if (reader.isClosed()) {
+                break;
+            }
+            if (!reader.wait(1000) && !reader.isWriterAlive()) {
+                // The writer died without closing the bus; follow the one it is restarted
+                // with, from its start.
+                std::cerr << "Writer of " << name << " is gone, waiting for a new bus..." << std::endl;
+                lostOnEarlierBuses += reader.getLostSamples();
+                reportedLost = 0;
+                while (!reader.open(name, true) || !reader.isWriterAlive()) {
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                }
+            }
+            continue;
+        }
+        for (size_t i = 0; i < count && (limit == 0 || received < limit); ++i, ++received) {
+            if (!quiet) {
+                std::printf("%lld %d %.2f\n", static_cast<long long>(samples[i].timestamp), samples[i].sensorId, samples[i].value);
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::fprintf(stderr, "received %llu samples in %.3f s, lost %llu%s\n", received, seconds, lostOnEarlierBuses + reader.getLostSamples(),
+                 reader.isClosed() ? ", writer closed" : "");
+    return 0;
+}
@@ -1,5 +1,7 @@
 
 #include "logger.h"
+#include "compressed_block.h"
+#include "sample_bus.h"
 #include <algorithm>
 #include <chrono>
 #include <cmath>
@@ -7,47 +9,202 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
 #include <deque>
 
-std::chrono::time_point<std::chrono::system_clock> programStartTime;
-bool isProgramStartTimeSet = false;
-
-time_t Logger::getCurrentTime() {
-    auto now = std::chrono::system_clock::now();
-    time_t currentTime = std::chrono::system_clock::to_time_t(now);
-
+static const time_t cleanupInterval = 60;
+static const time_t allReadingsRetention = 24 * 3600;
+static const time_t hourlyAverageRetention = 30 * 24 * 3600;
+static const time_t dailyAverageRetention = 365 * 24 * 3600;
+static const std::chrono::seconds snapshotInterval(60);
+static const time_t lateReadingWindow = 3600;
+static const size_t compressedBlockPoints = 3600;
+static const int schemaVersion = 5;
+static const time_t minuteRollupRetention = 7 * 24 * 3600;
+static const time_t hourRollupRetention = 365 * 24 * 3600;
+static const time_t dayRollupRetention = 10 * 365 * 24 * 3600;
+static const int defaultSensorId = 0;
+
+static Clock *createClock(int scale) {
 #ifdef USE_SIMULATION
-    if (!isProgramStartTimeSet) {
-        programStartTime = now;
-        isProgramStartTimeSet = true;
-    }
+    return new ScaledClock(scale);
+#else
+    (void)scale;
+    return new SystemClock();
+#endif
+}
 
-    auto duration = now - programStartTime;
-    double timeDiff = std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
-    currentTime = static_cast<time_t>(std::chrono::system_clock::to_time_t(programStartTime) + timeDiff * simulationScale_);
+time_t Logger::getCurrentTime() {
+    return clock_->now();
+}
 
-#endif
+Logger::Logger(const std::string &dbPath, int scale)
+    : dbPath_(dbPath), snapshotPath_(dbPath + ".snapshot"), ownedClock_(createClock(scale)), clock_(ownedClock_.get()), lastCleanupTime_(0), db_(nullptr),
+      insertHourlyStmt_(nullptr), insertDailyStmt_(nullptr), rejectedSamples_(0), seriesListener_(nullptr), sampleBus_(nullptr),
+      hasLatestSample_(false) {
+    openDatabase();
+}
 
-    return currentTime;
+Logger::Logger(const std::string &dbPath, Clock &clock)
+    : dbPath_(dbPath), snapshotPath_(dbPath + ".snapshot"), clock_(&clock), lastCleanupTime_(0), db_(nullptr),
+      insertHourlyStmt_(nullptr), insertDailyStmt_(nullptr), rejectedSamples_(0), seriesListener_(nullptr), sampleBus_(nullptr),
+      hasLatestSample_(false) {
+    openDatabase();
 }
 
-Logger::Logger(const std::string &dbPath, int scale) : dbPath_(dbPath), simulationScale_(scale), db_(nullptr), insertStmt_(nullptr) {
+void Logger::openDatabase() {
     int rc = sqlite3_open(dbPath_.c_str(), &db_);
     if (rc) {
         std::cerr << "Can't open database: " << sqlite3_errmsg(db_) << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
         return;
     }
 
     createTableIfNotExist();
+    readingPartitions_.open(db_);
+    rollups_.open(db_);
+    migrateSchema();
     prepareStatements();
+    restoreState();
+}
+
+int Logger::getSchemaVersion() {
+    sqlite3_stmt *stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+void Logger::setSchemaVersion(int version) {
+    std::string sql = "PRAGMA user_version = " + std::to_string(version) + ";";
+    char *errMsg = nullptr;
+    int rc = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+    }
+}
+
+void Logger::migrateSchema() {
+    // Version 1: raw readings split into daily partitions.
+    // Version 2: partition rows WITHOUT ROWID, keyed by (sensor_id, time), centi-degree values.
+    // Version 3: count/sum/min/max/sumsq rollups.
+    // Version 4: t-digest sketches on hourly and daily rollups. From before version 3 both
+    // are built from the readings still stored; a version 3 database keeps its rollups,
+    // which outlive the readings, and only the hours the readings cover get sketches.
+    // Version 5: seq added to the partition row key, so sub-second samples are kept.
+    int version = getSchemaVersion();
+    if (version > schemaVersion) {
+        std::cerr << "Database schema version " << version << " is newer than supported version " << schemaVersion << std::endl;
+        return;
+    }
+
+    if (version < 1) {
+        if (!readingPartitions_.migrateLegacyTables()) {
+            return;
+        }
+        setSchemaVersion(1);
+    }
+    if (version < 2) {
+        if (!readingPartitions_.migrateRowSchema()) {
+            return;
+        }
+        setSchemaVersion(2);
+    }
+    if (version < 4) {
+        if (!rollups_.addSketchColumns()) {
+            return;
+        }
+        ReadingSeries series;
+        readingPartitions_.read(defaultSensorId, std::numeric_limits<time_t>::min(), std::numeric_limits<time_t>::max(), series);
+        if (version < 3) {
+            rollups_.rebuild(defaultSensorId, series);
+        } else {
+            rollups_.backfillSketches(defaultSensorId, series);
+        }
+        setSchemaVersion(4);
+    }
+    if (version < 5) {
+        if (!readingPartitions_.migrateRowSequence()) {
+            return;
+        }
+        setSchemaVersion(5);
+    }
 }
 
+void Logger::restoreState() {
+    time_t now = getCurrentTime();
+    time_t readingsSince = now - allReadingsRetention;
+    time_t hourlySince = now - hourlyAverageRetention;
+    time_t dailySince = now - dailyAverageRetention;
+
+    LoggerSnapshot snapshot;
+    if (readSnapshot(snapshotPath_, snapshot)) {
+        temperatureReadings_ = std::move(snapshot.readings);
+        hourlyAverageReadings_ = std::move(snapshot.hourlyAverages);
+        dailyAverageReadings_ = std::move(snapshot.dailyAverages);
+        hourlySince = dailySince = snapshot.snapshotTime;
+        // A reading stamped before the snapshot but logged after it is only in the
+        // database, and nothing stored records write order. So readings are merged from
+        // lateReadingWindow before the snapshot, and the snapshot's own copies of that
+        // stretch are dropped. A reading logged more than lateReadingWindow after its
+        // timestamp, and after the last snapshot, is still on disk but not restored.
+        readingsSince = snapshot.snapshotTime - lateReadingWindow;
+        temperatureReadings_.erase(std::remove_if(temperatureReadings_.begin(), temperatureReadings_.end(),
+                                                  [readingsSince](const std::pair<time_t, double> &reading) {
+                                                      return reading.first >= readingsSince;
+                                                  }),
+                                   temperatureReadings_.end());
+    }
+
+    readingPartitions_.read(defaultSensorId, readingsSince, std::numeric_limits<time_t>::max(), temperatureReadings_);
+    loadSeries("SELECT time, average FROM hourly_average WHERE time >= ? ORDER BY time;", hourlySince, hourlyAverageReadings_);
+    loadSeries("SELECT time, average FROM daily_average WHERE time >= ? ORDER BY time;", dailySince, dailyAverageReadings_);
+
+    cleanupLogs();
+    lastSnapshot_ = std::chrono::steady_clock::now();
+}
+
+void Logger::loadSeries(const char *sql, time_t since, std::deque<std::pair<time_t, double>> &series) {
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, since);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        series.push_back(std::make_pair(static_cast<time_t>(sqlite3_column_int64(stmt, 0)), sqlite3_column_double(stmt, 1)));
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+}
+
+bool Logger::saveSnapshot() {
+    lastSnapshot_ = std::chrono::steady_clock::now();
+    return writeSnapshot(snapshotPath_, getCurrentTime(), temperatureReadings_, hourlyAverageReadings_, dailyAverageReadings_);
+}
 
 Logger::~Logger() {
+    if (db_) {
+        saveSnapshot();
+    }
     finalizeStatements();
+    rollups_.flushAll();
+    rollups_.close();
+    readingPartitions_.close();
     if (db_) {
         sqlite3_close(db_);
     }
@@ -60,10 +217,6 @@ void Logger::createTableIfNotExist() {
     }
 
     const char *createTablesSQL =
-        "CREATE TABLE IF NOT EXISTS all_readings ("
-        "   time INTEGER NOT NULL,"
-        "   temperature REAL NOT NULL"
-        ");"
         "CREATE TABLE IF NOT EXISTS hourly_average ("
         "   time INTEGER NOT NULL,"
         "   average REAL NOT NULL"
@@ -71,7 +224,9 @@ void Logger::createTableIfNotExist() {
         "CREATE TABLE IF NOT EXISTS daily_average ("
         "   time INTEGER NOT NULL,"
         "   average REAL NOT NULL"
-        ");";
+        ");"
+        "CREATE INDEX IF NOT EXISTS hourly_average_time ON hourly_average (time);"
+        "CREATE INDEX IF NOT EXISTS daily_average_time ON daily_average (time);";
 
     char *errMsg = nullptr;
     int rc = sqlite3_exec(db_, createTablesSQL, nullptr, nullptr, &errMsg);
@@ -86,15 +241,8 @@ void Logger::prepareStatements() {
         return;
     }
 
-    const char *insertSQL = "INSERT INTO all_readings (time, temperature) VALUES (?, ?);";
-    int rc = sqlite3_prepare_v2(db_, insertSQL, -1, &insertStmt_, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Error preparing insert statement: " << sqlite3_errmsg(db_) << std::endl;
-        insertStmt_ = nullptr;
-    }
-
-   const char *insertHourlySQL = "INSERT INTO hourly_average (time, average) VALUES (?, ?);";
-    rc = sqlite3_prepare_v2(db_, insertHourlySQL, -1, &insertHourlyStmt_, nullptr);
+    const char *insertHourlySQL = "INSERT INTO hourly_average (time, average) VALUES (?, ?);";
+    int rc = sqlite3_prepare_v2(db_, insertHourlySQL, -1, &insertHourlyStmt_, nullptr);
     if (rc != SQLITE_OK) {
         std::cerr << "Error preparing insert hourly average statement: " << sqlite3_errmsg(db_) << std::endl;
         insertHourlyStmt_ = nullptr;
@@ -110,11 +258,6 @@ void Logger::prepareStatements() {
 
 
 void Logger::finalizeStatements() {
-    if (insertStmt_) {
-        sqlite3_finalize(insertStmt_);
-        insertStmt_ = nullptr;
-    }
-
     if (insertHourlyStmt_) {
         sqlite3_finalize(insertHourlyStmt_);
         insertHourlyStmt_ = nullptr;
@@ -127,19 +270,12 @@ void Logger::finalizeStatements() {
 }
 
 
-void Logger::insertReading(time_t time, double temp) {
-    if (!db_ || !insertStmt_) {
+void Logger::insertReading(int sensorId, time_t time, double temp) {
+    if (!db_) {
         return;
     }
 
-    sqlite3_reset(insertStmt_);
-    sqlite3_bind_int64(insertStmt_, 1, time);
-    sqlite3_bind_double(insertStmt_, 2, temp);
-
-    int rc = sqlite3_step(insertStmt_);
-    if (rc != SQLITE_DONE) {
-         std::cerr << "SQL error during insert: " << sqlite3_errmsg(db_) << std::endl;
-    }
+    readingPartitions_.insert(sensorId, time, temp);
 }
 
 
@@ -169,24 +305,87 @@ void Logger::insertAverage(time_t time, double average, const std::string &table
 
 
 void Logger::logTemperature(const std::string &temperature) {
-    time_t currentTime = getCurrentTime();
-    try {
-        double tempValue = std::stod(temperature);
-        temperatureReadings_.push_back(std::make_pair(currentTime, tempValue));
-        insertReading(currentTime, tempValue);
+    double tempValue = 0.0;
+    ParseStatus status = parseTemperature(temperature, tempValue);
+    if (status != ParseStatus::Ok) {
+        rejectSample(status);
+        return;
+    }
 
-    } catch (std::invalid_argument &e) {
-        std::cerr << "Error converting temperature to double: " << e.what() << std::endl;
-    } catch (std::out_of_range &e) {
-        std::cerr << "Error converting temperature to double: " << e.what() << std::endl;
+    logTemperature(tempValue);
+}
+
+void Logger::logTemperature(double temperature) {
+    Sample sample;
+    sample.sensorId = 0;
+    sample.timestamp = 0;
+    sample.value = temperature;
+    sample.quality = SampleQuality::Good;
+    logSample(sample);
+}
+
+void Logger::logSample(const Sample &sample) {
+    if (!std::isfinite(sample.value)) {
+        rejectSample(ParseStatus::OutOfRange);
+        return;
+    }
+
+    Sample stamped = sample;
+    if (stamped.timestamp == 0) {
+        stamped.timestamp = getCurrentTime();
+    }
+
+    appendToSeries(SeriesKind::Readings, temperatureReadings_, stamped.timestamp, stamped.value);
+    insertReading(stamped.sensorId, stamped.timestamp, stamped.value);
+    if (db_) {
+        rollups_.add(stamped.sensorId, stamped.timestamp, stamped.value);
+    }
+    if (sampleBus_) {
+        sampleBus_->publish(stamped);
+    }
+
+    std::lock_guard<std::mutex> lock(latestSampleMutex_);
+    latestSample_ = stamped;
+    hasLatestSample_ = true;
+}
+
+bool Logger::getLatestSample(Sample &sample) const {
+    std::lock_guard<std::mutex> lock(latestSampleMutex_);
+    if (!hasLatestSample_) {
+        return false;
+    }
+    sample = latestSample_;
+    return true;
+}
+
+unsigned long long Logger::getRejectedSamples() const {
+    return rejectedSamples_;
+}
+
+void Logger::rejectSample(ParseStatus status) {
+    ++rejectedSamples_;
+    if (rejectedSamples_ == 1 || rejectedSamples_ % 1000 == 0) {
+        std::cerr << "Error converting temperature to double: " << parseStatusMessage(status)
+                  << " (rejected samples: " << rejectedSamples_ << ")" << std::endl;
     }
 }
 
 void Logger::updateLogs() {
     calculateHourlyAverage();
     calculateDailyAverage();
-    cleanupLogs();
-    cleanupDatabase();
+
+    time_t now = getCurrentTime();
+    rollups_.flushClosed(now);
+    if (now - lastCleanupTime_ >= cleanupInterval) {
+        cleanupLogs();
+        readingPartitions_.compact(now);
+        cleanupDatabase();
+        lastCleanupTime_ = now;
+    }
+
+    if (std::chrono::steady_clock::now() - lastSnapshot_ >= snapshotInterval) {
+        saveSnapshot();
+    }
 }
 
 void Logger::writeLog(const std::string &fileName, const std::string &message, bool append) {
@@ -212,6 +411,9 @@ void Logger::calculateHourlyAverage() {
 
     time_t now = getCurrentTime();
     time_t currentHour = now - (now % 3600);
+    if (!hourlyAverageReadings_.empty() && hourlyAverageReadings_.back().first == currentHour) {
+        return;
+    }
 
     double sum = 0.0;
     int count = 0;
@@ -225,10 +427,8 @@ void Logger::calculateHourlyAverage() {
 
     if (count > 0) {
         double average = sum / count;
-        if (hourlyAverageReadings_.empty() || hourlyAverageReadings_.back().first != currentHour) {
-             hourlyAverageReadings_.push_back(std::make_pair(currentHour, average));
-             insertAverage(currentHour, average, "hourly_average");
-        }
+        appendToSeries(SeriesKind::HourlyAverages, hourlyAverageReadings_, currentHour, average);
+        insertAverage(currentHour, average, "hourly_average");
     }
 }
 
@@ -239,6 +439,9 @@ void Logger::calculateDailyAverage() {
 
     time_t now = getCurrentTime();
     time_t currentDay = now - (now % 86400);
+    if (!dailyAverageReadings_.empty() && dailyAverageReadings_.back().first == currentDay) {
+        return;
+    }
 
     double sum = 0.0;
     int count = 0;
@@ -252,30 +455,58 @@ void Logger::calculateDailyAverage() {
 
     if (count > 0) {
         double average = sum / count;
-
-        if (dailyAverageReadings_.empty() || dailyAverageReadings_.back().first != currentDay) {
-              dailyAverageReadings_.push_back(std::make_pair(currentDay, average));
-              insertAverage(currentDay, average, "daily_average");
-        }
+        appendToSeries(SeriesKind::DailyAverages, dailyAverageReadings_, currentDay, average);
+        insertAverage(currentDay, average, "daily_average");
     }
 }
 
 void Logger::cleanupLogs() {
     time_t now = getCurrentTime();
-    time_t oneDayAgo = now - (24 * 3600);
-    time_t oneMonthAgo = now - (30 * 24 * 3600);
-    time_t oneYearAgo = now - (365 * 24 * 3600);
+    time_t oneDayAgo = now - allReadingsRetention;
+    time_t oneMonthAgo = now - hourlyAverageRetention;
+    time_t oneYearAgo = now - dailyAverageRetention;
+
+    expireSeries(SeriesKind::Readings, temperatureReadings_, oneDayAgo);
+    expireSeries(SeriesKind::HourlyAverages, hourlyAverageReadings_, oneMonthAgo);
+    expireSeries(SeriesKind::DailyAverages, dailyAverageReadings_, oneYearAgo);
+}
 
-    while (!temperatureReadings_.empty() && temperatureReadings_.front().first < oneDayAgo) {
-        temperatureReadings_.pop_front();
+void Logger::appendToSeries(SeriesKind kind, std::deque<std::pair<time_t, double>> &series, time_t time, double value) {
+    series.push_back(std::make_pair(time, value));
+    if (seriesListener_) {
+        seriesListener_->seriesAppended(kind, time, value);
     }
+}
 
-    while (!hourlyAverageReadings_.empty() && hourlyAverageReadings_.front().first < oneMonthAgo) {
-        hourlyAverageReadings_.pop_front();
+void Logger::expireSeries(SeriesKind kind, std::deque<std::pair<time_t, double>> &series, time_t before) {
+    if (series.empty() || series.front().first >= before) {
+        return;
+    }
+    while (!series.empty() && series.front().first < before) {
+        series.pop_front();
     }
+    if (seriesListener_) {
+        seriesListener_->seriesExpired(kind, before);
+    }
+}
 
-    while (!dailyAverageReadings_.empty() && dailyAverageReadings_.front().first < oneYearAgo) {
-         dailyAverageReadings_.pop_front();
+void Logger::setSampleBus(SampleBusWriter *bus) {
+    sampleBus_ = bus;
+}
+
+void Logger::setSeriesListener(SeriesListener *listener) {
+    seriesListener_ = listener;
+    if (!listener) {
+        return;
+    }
+    for (const auto &reading : temperatureReadings_) {
+        listener->seriesAppended(SeriesKind::Readings, reading.first, reading.second);
+    }
+    for (const auto &reading : hourlyAverageReadings_) {
+        listener->seriesAppended(SeriesKind::HourlyAverages, reading.first, reading.second);
+    }
+    for (const auto &reading : dailyAverageReadings_) {
+        listener->seriesAppended(SeriesKind::DailyAverages, reading.first, reading.second);
     }
 }
 
@@ -285,27 +516,16 @@ void Logger::cleanupDatabase() {
     }
 
     time_t now = getCurrentTime();
-    time_t oneDayAgo = now - (24 * 3600);
-    time_t oneMonthAgo = now - (30 * 24 * 3600);
-    time_t oneYearAgo = now - (365 * 24 * 3600);
+    time_t oneDayAgo = now - allReadingsRetention;
+    time_t oneMonthAgo = now - hourlyAverageRetention;
+    time_t oneYearAgo = now - dailyAverageRetention;
 
     char *errMsg = nullptr;
     int rc;
 
-    // Delete from all_readings
-    std::string deleteReadingsSQL = "DELETE FROM all_readings WHERE time < ?";
-    sqlite3_stmt *deleteReadingsStmt;
-    rc = sqlite3_prepare_v2(db_, deleteReadingsSQL.c_str(), -1, &deleteReadingsStmt, nullptr);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Error preparing delete readings statement: " << sqlite3_errmsg(db_) << std::endl;
-        return;
-    }
-    sqlite3_bind_int64(deleteReadingsStmt, 1, oneDayAgo);
-    rc = sqlite3_step(deleteReadingsStmt);
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Error deleting from all_readings: " << sqlite3_errmsg(db_) << std::endl;
-    }
-    sqlite3_finalize(deleteReadingsStmt);
+    // Drop whole daily partitions of all_readings
+    readingPartitions_.dropBefore(oneDayAgo);
+    rollups_.expire(now - minuteRollupRetention, now - hourRollupRetention, now - dayRollupRetention);
 
     // Delete from hourly_average
     std::string deleteHourlySQL = "DELETE FROM hourly_average WHERE time < ?";
@@ -341,82 +561,100 @@ void Logger::cleanupDatabase() {
 }
 
 std::vector<std::pair<time_t, double>> Logger::getAllReadings() {
-    std::vector<std::pair<time_t, double>> readings;
-    if (!db_) {
-        return readings;
-    }
+    return getReadings(std::numeric_limits<time_t>::min(), std::numeric_limits<time_t>::max());
+}
 
-    const char *sql = "SELECT time, temperature FROM all_readings;";
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+std::vector<std::pair<time_t, double>> Logger::getReadings(time_t from, time_t to, int sensorId) {
+    // Partitions are dropped a whole day at a time, so clip to the retention window here.
+    ReadingSeries series;
+    readingPartitions_.read(sensorId, std::max(from, getCurrentTime() - allReadingsRetention), to, series);
+    return std::vector<std::pair<time_t, double>>(series.begin(), series.end());
+}
 
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
-        return readings;
-    }
+std::string Logger::exportReadings(time_t from, time_t to, int sensorId) {
+    ReadingSeries series;
+    readingPartitions_.read(sensorId, std::max(from, getCurrentTime() - allReadingsRetention), to, series);
 
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        time_t time = sqlite3_column_int64(stmt, 0);
-        double temp = sqlite3_column_double(stmt, 1);
-        readings.push_back(std::make_pair(time, temp));
-    }
+    std::string out;
+    BlockEncoder encoder;
+    auto writeFrame = [&]() {
+        std::uint32_t length = static_cast<std::uint32_t>(encoder.encodedSize());
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<char>(length >> (8 * i)));
+        }
+        encoder.encode(out);
+        encoder.clear();
+    };
 
-    if (rc != SQLITE_DONE) {
-        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
+    for (const auto &reading : series) {
+        if (encoder.size() >= compressedBlockPoints) {
+            writeFrame();
+        }
+        encoder.append(reading.first, reading.second);
     }
-
-    sqlite3_finalize(stmt);
-    return readings;
+    if (encoder.size() > 0) {
+        writeFrame();
+    }
+    return out;
 }
 
-std::vector<std::pair<time_t, double>> Logger::getHourlyAverageReadings() {
-      std::vector<std::pair<time_t, double>> readings;
-    if (!db_) {
-        return readings;
-    }
+std::vector<RollupBucket> Logger::getRollups(RollupLevel level, time_t from, time_t to, int sensorId) {
+    return rollups_.query(level, sensorId, from, to);
+}
 
-    const char *sql = "SELECT time, average FROM hourly_average;";
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+std::vector<RollupBucket> Logger::getAggregate(time_t from, time_t to, time_t step, int sensorId) {
+    return rollups_.aggregate(sensorId, from, to, step);
+}
 
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
-        return readings;
+time_t Logger::getRollupRetention(RollupLevel level) const {
+    switch (level) {
+    case RollupLevel::Minute:
+        return minuteRollupRetention;
+    case RollupLevel::Hour:
+        return hourRollupRetention;
+    case RollupLevel::Day:
+        return dayRollupRetention;
     }
+    return minuteRollupRetention;
+}
 
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-        time_t time = sqlite3_column_int64(stmt, 0);
-        double average = sqlite3_column_double(stmt, 1);
-        readings.push_back(std::make_pair(time, average));
+std::vector<double> Logger::getQuantiles(time_t from, time_t to, const std::vector<double> &quantiles, int sensorId) {
+    TDigest sketch = rollups_.sketch(sensorId, from, to);
+    std::vector<double> values;
+    for (double q : quantiles) {
+        values.push_back(sketch.quantile(q));
     }
+    return values;
+}
 
-     if (rc != SQLITE_DONE) {
-        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
-    }
+std::vector<std::pair<time_t, double>> Logger::getHourlyAverageReadings(time_t since) {
+    return readAverages("hourly_average", since);
+}
 
-    sqlite3_finalize(stmt);
-    return readings;
+std::vector<std::pair<time_t, double>> Logger::getDailyAverageReadings(time_t since) {
+    return readAverages("daily_average", since);
 }
 
-std::vector<std::pair<time_t, double>> Logger::getDailyAverageReadings() {
-      std::vector<std::pair<time_t, double>> readings;
+std::vector<std::pair<time_t, double>> Logger::readAverages(const char *table, time_t since) {
+    std::vector<std::pair<time_t, double>> readings;
     if (!db_) {
         return readings;
     }
 
-    const char *sql = "SELECT time, average FROM daily_average;";
+    std::string sql = std::string("SELECT time, average FROM ") + table + " WHERE time > ? ORDER BY time;";
     sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+    int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
 
     if (rc != SQLITE_OK) {
         std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
         return readings;
     }
 
+    sqlite3_bind_int64(stmt, 1, since);
     while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         time_t time = sqlite3_column_int64(stmt, 0);
         double average = sqlite3_column_double(stmt, 1);
-       readings.push_back(std::make_pair(time, average));
+        readings.push_back(std::make_pair(time, average));
     }
 
     if (rc != SQLITE_DONE) {
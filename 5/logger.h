@@ -1,30 +1,85 @@
+#pragma once
+
 #include <string>
 #include <vector>
 #include <ctime>
+#include <chrono>
 #include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include "sqlite3.h"
+#include "clock.h"
+#include "reading_partitions.h"
+#include "rollups.h"
+#include "sample.h"
+#include "snapshot.h"
+#include "temperature_parser.h"
+
+enum class SeriesKind {
+    Readings,
+    HourlyAverages,
+    DailyAverages
+};
+
+// Told about every change to Logger's in-memory series, on the thread that made it.
+class SeriesListener {
+public:
+    virtual ~SeriesListener() = default;
+    virtual void seriesAppended(SeriesKind kind, time_t time, double value) = 0;
+    virtual void seriesExpired(SeriesKind kind, time_t before) = 0;
+};
+
+class SampleBusWriter;
 
 class Logger {
 public:
     Logger(const std::string &dbPath, int scale = 1);
+    Logger(const std::string &dbPath, Clock &clock);
     ~Logger();
 
     void logTemperature(const std::string &temperature);
+    void logTemperature(double temperature);
+    void logSample(const Sample &sample);
+    bool getLatestSample(Sample &sample) const;
+    unsigned long long getRejectedSamples() const;
     void updateLogs();
+    bool saveSnapshot();
     void writeLog(const std::string &fileName, const std::string &message, bool append = true);
 
     std::vector<std::pair<time_t, double>> getAllReadings();
-    std::vector<std::pair<time_t, double>> getHourlyAverageReadings();
-    std::vector<std::pair<time_t, double>> getDailyAverageReadings();
+    std::vector<std::pair<time_t, double>> getReadings(time_t from, time_t to, int sensorId = 0);
+    std::string exportReadings(time_t from, time_t to, int sensorId = 0);
+    std::vector<RollupBucket> getRollups(RollupLevel level, time_t from, time_t to, int sensorId = 0);
+    std::vector<RollupBucket> getAggregate(time_t from, time_t to, time_t step, int sensorId = 0);
+    time_t getRollupRetention(RollupLevel level) const;
+    std::vector<double> getQuantiles(time_t from, time_t to, const std::vector<double> &quantiles, int sensorId = 0);
+    std::vector<std::pair<time_t, double>> getHourlyAverageReadings(time_t since = std::numeric_limits<time_t>::min());
+    std::vector<std::pair<time_t, double>> getDailyAverageReadings(time_t since = std::numeric_limits<time_t>::min());
 
+    // Replays the current series to the listener, then reports changes as they happen.
+    // Call it from the ingest thread or before ingest starts.
+    void setSeriesListener(SeriesListener *listener);
+    // Every accepted sample is also published to the bus, with its final timestamp.
+    void setSampleBus(SampleBusWriter *bus);
 
 private:
     time_t getCurrentTime();
+    void openDatabase();
+    int getSchemaVersion();
+    void setSchemaVersion(int version);
+    void migrateSchema();
+    void restoreState();
+    std::vector<std::pair<time_t, double>> readAverages(const char *table, time_t since);
+    void loadSeries(const char *sql, time_t since, std::deque<std::pair<time_t, double>> &series);
     void createTableIfNotExist();
     void prepareStatements();
     void finalizeStatements();
-    void insertReading(time_t time, double temp);
+    void insertReading(int sensorId, time_t time, double temp);
     void insertAverage(time_t time, double average, const std::string &table);
+    void rejectSample(ParseStatus status);
+    void appendToSeries(SeriesKind kind, std::deque<std::pair<time_t, double>> &series, time_t time, double value);
+    void expireSeries(SeriesKind kind, std::deque<std::pair<time_t, double>> &series, time_t before);
 
     void calculateHourlyAverage();
     void calculateDailyAverage();
@@ -32,11 +87,23 @@ private:
     void cleanupDatabase();
 
     std::string dbPath_;
-    int simulationScale_;
+    std::string snapshotPath_;
+    std::chrono::steady_clock::time_point lastSnapshot_;
+    std::unique_ptr<Clock> ownedClock_;
+    Clock *clock_;
+    time_t lastCleanupTime_;
     sqlite3 *db_;
-    sqlite3_stmt *insertStmt_;
+    ReadingPartitions readingPartitions_;
+    Rollups rollups_;
     sqlite3_stmt *insertHourlyStmt_;
     sqlite3_stmt *insertDailyStmt_;
+    unsigned long long rejectedSamples_;
+    SeriesListener *seriesListener_;
+    SampleBusWriter *sampleBus_;
+
+    mutable std::mutex latestSampleMutex_;
+    Sample latestSample_;
+    bool hasLatestSample_;
 
     std::deque<std::pair<time_t, double>> temperatureReadings_;
     std::deque<std::pair<time_t, double>> hourlyAverageReadings_;
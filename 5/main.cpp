@@ -1,13 +1,23 @@
 #include "httplib/httplib.h"
 #include "logger.h"
+#include "replay_source.h"
+#include "sample_bus.h"
+#include "sample_parser.h"
 #include "serial_port.h"
+#include "subscription_server.h"
 #include "temperature_sensor.h"
+#include <charconv>
+#include <cmath>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 std::string formatTime(time_t time) {
     std::tm t;
@@ -29,11 +39,111 @@ std::string createJsonArray(const std::vector<std::pair<time_t, double>> &data)
     return json;
 }
 
+std::string createRollupJsonArray(const std::vector<RollupBucket> &buckets) {
+    std::string json = "[";
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        const RollupBucket &bucket = buckets[i];
+        json += "{\"time\":\"" + formatTime(bucket.start) + "\",\"count\":" + std::to_string(bucket.count) +
+                ",\"mean\":" + std::to_string(bucket.mean()) + ",\"min\":" + std::to_string(bucket.min) +
+                ",\"max\":" + std::to_string(bucket.max) + ",\"stddev\":" + std::to_string(bucket.stddev());
+        if (!bucket.sketch.empty()) {
+            json += ",\"p5\":" + std::to_string(bucket.sketch.quantile(0.05)) + ",\"p50\":" + std::to_string(bucket.sketch.quantile(0.5)) +
+                    ",\"p95\":" + std::to_string(bucket.sketch.quantile(0.95));
+        }
+        json += "}";
+        if (i < buckets.size() - 1) {
+            json += ",";
+        }
+    }
+    json += "]";
+    return json;
+}
+
+bool parseTimeParam(const httplib::Request &req, const char *name, time_t &time) {
+    if (!req.has_param(name)) {
+        return true;
+    }
+    std::string text = req.get_param_value(name);
+    long long value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+        return false;
+    }
+    time = static_cast<time_t>(value);
+    return true;
+}
+
+bool parseQuantiles(const httplib::Request &req, std::vector<double> &quantiles) {
+    if (!req.has_param("q")) {
+        quantiles = {0.05, 0.5, 0.95};
+        return true;
+    }
+    std::string text = req.get_param_value("q");
+    const char *p = text.data();
+    const char *end = text.data() + text.size();
+    while (p != end) {
+        double value = 0.0;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc() || value < 0.0 || value > 1.0 || (result.ptr != end && *result.ptr != ',')) {
+            return false;
+        }
+        quantiles.push_back(value);
+        p = result.ptr == end ? end : result.ptr + 1;
+    }
+    return !quantiles.empty();
+}
+
+bool parseTimeRange(const httplib::Request &req, time_t &from, time_t &to) {
+    return parseTimeParam(req, "from", from) && parseTimeParam(req, "to", to);
+}
+
 int main(int argc, char *argv[]) {
     const std::string portName = "COM3";
     SerialPort serialPort(portName);
     int scale = 1;
-    if (argc > 1) {
+    long virtualPeriod = 0;
+    long virtualDuration = 0;
+    std::string replayPath;
+    double replaySpeed = 1.0;
+    if (argc > 1 && std::strcmp(argv[1], "--replay") == 0) {
+        if (argc < 3) {
+            std::cerr << "Missing replay file. Usage: " << argv[0] << " --replay FILE [SPEED|max]" << std::endl;
+            return 1;
+        }
+        replayPath = argv[2];
+        if (argc > 3) {
+            if (std::strcmp(argv[3], "max") == 0) {
+                replaySpeed = 0.0;
+            } else {
+                char *endptr = nullptr;
+                replaySpeed = strtod(argv[3], &endptr);
+                if (*endptr != '\0' || replaySpeed <= 0) {
+                    std::cerr << "Invalid replay speed. Usage: " << argv[0] << " --replay FILE [SPEED|max]" << std::endl;
+                    return 1;
+                }
+            }
+        }
+        virtualPeriod = 1;
+    } else if (argc > 1 && std::strcmp(argv[1], "--virtual") == 0) {
+#ifdef USE_SIMULATION
+        char *endptr = nullptr;
+        virtualPeriod = argc > 2 ? strtol(argv[2], &endptr, 10) : 1;
+        if (argc > 2 && (*endptr != '\0' || virtualPeriod <= 0)) {
+            std::cerr << "Invalid sample period. Usage: " << argv[0] << " --virtual PERIOD_SECONDS [DURATION_SECONDS]" << std::endl;
+            return 1;
+        }
+        if (argc > 3) {
+            virtualDuration = strtol(argv[3], &endptr, 10);
+            if (*endptr != '\0' || virtualDuration < 0) {
+                std::cerr << "Invalid duration. Usage: " << argv[0] << " --virtual PERIOD_SECONDS [DURATION_SECONDS]" << std::endl;
+                return 1;
+            }
+        }
+#else
+        std::cerr << "Virtual clock mode requires a build with USE_SIMULATION" << std::endl;
+        return 1;
+#endif
+    } else if (argc > 1) {
         char *endptr;
         long parsedScale = strtol(argv[1], &endptr, 10);
 
@@ -44,43 +154,108 @@ int main(int argc, char *argv[]) {
         }
     }
     const std::string dbName = "temperature_data.db";
+    const std::string socketName = "temperature_monitor.sock";
+    const std::string busName = "/temperature_monitor";
+    const std::uint32_t busCapacity = 65536;
     TemperatureSensor sensor;
-    Logger logger(dbName, scale);
+
+    std::unique_ptr<VirtualClock> virtualClock;
+    std::unique_ptr<Logger> loggerPtr;
+    if (virtualPeriod > 0) {
+        virtualClock = std::make_unique<VirtualClock>(time(nullptr), virtualPeriod);
+        loggerPtr = std::make_unique<Logger>(dbName, *virtualClock);
+    } else {
+        loggerPtr = std::make_unique<Logger>(dbName, scale);
+    }
+    Logger &logger = *loggerPtr;
 
     httplib::Server svr;
 
     svr.Get("/current", [&](const httplib::Request &, httplib::Response &res) {
-        std::string temperature;
-#ifdef USE_SIMULATION
-        temperature = sensor.getTemperature();
-#else
-        if (!serialPort.isOpen()) {
-            if (!serialPort.openPort()) {
-                std::cerr << "Failed to open port, retrying in 5 seconds..." << std::endl;
-                std::this_thread::sleep_for(std::chrono::seconds(5));
-                res.set_content("Failed to get temperature", "text/plain");
-                return;
-            } else {
-                std::cout << "Port successfully opened" << std::endl;
-            }
-        }
-
-        temperature = serialPort.readData();
-
-        if (temperature.empty()) {
+        Sample sample;
+        if (!logger.getLatestSample(sample)) {
             res.set_content("Failed to get temperature", "text/plain");
             return;
         }
-#endif
-        res.set_content(temperature, "text/plain");
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << sample.value;
+        res.set_content(ss.str(), "text/plain");
     });
 
-    svr.Get("/all_readings", [&](const httplib::Request &, httplib::Response &res) {
-        std::vector<std::pair<time_t, double>> readings = logger.getAllReadings();
+    svr.Get("/all_readings", [&](const httplib::Request &req, httplib::Response &res) {
+        time_t from = std::numeric_limits<time_t>::min();
+        time_t to = std::numeric_limits<time_t>::max();
+        if (!parseTimeRange(req, from, to)) {
+            res.status = 400;
+            res.set_content("from and to must be unix timestamps", "text/plain");
+            return;
+        }
+        std::vector<std::pair<time_t, double>> readings = logger.getReadings(from, to);
         std::string jsonResponse = createJsonArray(readings);
         res.set_content(jsonResponse, "application/json");
     });
 
+    svr.Get("/all_readings/export", [&](const httplib::Request &req, httplib::Response &res) {
+        time_t from = std::numeric_limits<time_t>::min();
+        time_t to = std::numeric_limits<time_t>::max();
+        if (!parseTimeRange(req, from, to)) {
+            res.status = 400;
+            res.set_content("from and to must be unix timestamps", "text/plain");
+            return;
+        }
+        res.set_content(logger.exportReadings(from, to), "application/octet-stream");
+    });
+
+    svr.Get("/rollups", [&](const httplib::Request &req, httplib::Response &res) {
+        time_t from = std::numeric_limits<time_t>::min();
+        time_t to = std::numeric_limits<time_t>::max();
+        std::string level = req.has_param("level") ? req.get_param_value("level") : "hour";
+        if (!parseTimeRange(req, from, to) || (level != "minute" && level != "hour" && level != "day")) {
+            res.status = 400;
+            res.set_content("level must be minute, hour or day; from and to must be unix timestamps", "text/plain");
+            return;
+        }
+
+        RollupLevel rollupLevel = level == "minute" ? RollupLevel::Minute : level == "day" ? RollupLevel::Day : RollupLevel::Hour;
+        res.set_content(createRollupJsonArray(logger.getRollups(rollupLevel, from, to)), "application/json");
+    });
+
+    svr.Get("/aggregate", [&](const httplib::Request &req, httplib::Response &res) {
+        time_t from = std::numeric_limits<time_t>::min();
+        time_t to = std::numeric_limits<time_t>::max();
+        time_t step = 3600;
+        if (!parseTimeRange(req, from, to) || !parseTimeParam(req, "step", step) || step <= 0 || step % 60 != 0) {
+            res.status = 400;
+            res.set_content("step must be a positive multiple of 60 seconds; from and to must be unix timestamps", "text/plain");
+            return;
+        }
+        res.set_content(createRollupJsonArray(logger.getAggregate(from, to, step)), "application/json");
+    });
+
+    svr.Get("/quantiles", [&](const httplib::Request &req, httplib::Response &res) {
+        time_t from = std::numeric_limits<time_t>::min();
+        time_t to = std::numeric_limits<time_t>::max();
+        std::vector<double> quantiles;
+        if (!parseTimeRange(req, from, to) || !parseQuantiles(req, quantiles)) {
+            res.status = 400;
+            res.set_content("q must be a comma-separated list of quantiles in [0, 1]; from and to must be unix timestamps", "text/plain");
+            return;
+        }
+
+        std::vector<double> values = logger.getQuantiles(from, to, quantiles);
+        std::string json = "[";
+        for (size_t i = 0; i < quantiles.size(); ++i) {
+            json += "{\"q\":" + std::to_string(quantiles[i]) + ",\"value\":" +
+                    (std::isnan(values[i]) ? std::string("null") : std::to_string(values[i])) + "}";
+            if (i < quantiles.size() - 1) {
+                json += ",";
+            }
+        }
+        json += "]";
+        res.set_content(json, "application/json");
+    });
+
     svr.Get("/hourly_average", [&](const httplib::Request &, httplib::Response &res) {
         std::vector<std::pair<time_t, double>> readings = logger.getHourlyAverageReadings();
         std::string jsonResponse = createJsonArray(readings);
@@ -99,11 +274,53 @@ int main(int argc, char *argv[]) {
         svr.listen("0.0.0.0", 8080);
     });
 
+    SubscriptionServer subscriptions(socketName, logger);
+    if (subscriptions.start()) {
+        logger.setSeriesListener(&subscriptions);
+        std::cout << "Live series are published on " << socketName << std::endl;
+    }
+    SampleBusWriter sampleBus(busName, busCapacity);
+    if (sampleBus.open()) {
+        logger.setSampleBus(&sampleBus);
+        std::cout << "Live samples are published on shared memory " << busName << std::endl;
+    }
+
+    if (!replayPath.empty()) {
+        ReplaySource source(replayPath);
+        if (source.openFile()) {
+            runReplay(source, logger, *virtualClock, replaySpeed);
+        }
+        logger.setSeriesListener(nullptr);
+        logger.setSampleBus(nullptr);
+        subscriptions.stop();
+        sampleBus.close();
+        svr.stop();
+        server_thread.join();
+        return 0;
+    }
+
+    SampleParser parser;
+    std::vector<Sample> samples;
+
+#ifdef USE_SIMULATION
+    time_t virtualEnd = virtualClock ? virtualClock->now() + virtualDuration : 0;
+#endif
+    unsigned long long virtualSamples = 0;
+    auto wallStart = std::chrono::steady_clock::now();
+
     while (true) {
-        std::string temperature;
+        samples.clear();
 
 #ifdef USE_SIMULATION
-        temperature = sensor.getTemperature();
+        if (virtualClock) {
+            if (virtualDuration > 0 && virtualClock->now() >= virtualEnd) {
+                break;
+            }
+            samples.push_back(sensor.getSample(virtualClock->advance()));
+            ++virtualSamples;
+        } else {
+            samples.push_back(sensor.getSample());
+        }
 #else
         if (!serialPort.isOpen()) {
             if (!serialPort.openPort()) {
@@ -115,19 +332,29 @@ int main(int argc, char *argv[]) {
             }
         }
 
-        temperature = serialPort.readData();
-
-        if (temperature.empty()) {
+        if (parser.feed(serialPort.readData(), samples) == 0) {
             continue;
         }
 #endif
 
-        logger.logTemperature(temperature);
+        for (const auto &sample : samples) {
+            logger.logSample(sample);
+        }
         logger.updateLogs();
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (!virtualClock) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
     }
 
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    std::cout << "Simulated " << virtualDuration << " s with " << virtualSamples << " samples in " << wallSeconds << " s" << std::endl;
+
+    logger.setSeriesListener(nullptr);
+    logger.setSampleBus(nullptr);
+    subscriptions.stop();
+    sampleBus.close();
+    svr.stop();
     server_thread.join();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "snapshot.h"
+#include "sqlite3.h"
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Raw readings split into one table per UTC day: all_readings_YYYYMMDD holds rows while
+// the day is open, all_readings_blocks_YYYYMMDD holds its compressed blocks once closed.
+// Retention drops whole tables, and reads only visit the days overlapping the range.
+// Row tables are WITHOUT ROWID, keyed by (sensor_id, time, seq), with values in
+// centi-degrees; seq tells apart the samples that share a whole-second timestamp.
+class ReadingPartitions {
+public:
+    ReadingPartitions();
+    ~ReadingPartitions();
+
+    void open(sqlite3 *db);
+    void close();
+    bool migrateLegacyTables();
+    bool migrateRowSchema();
+    bool migrateRowSequence();
+
+    bool insert(int sensorId, time_t time, double value);
+    void read(int sensorId, time_t from, time_t to, ReadingSeries &series);
+    size_t compact(time_t now);
+    size_t dropBefore(time_t cutoff);
+    size_t getPartitionCount() const;
+
+private:
+    struct Partition {
+        bool hasRows;
+        bool hasBlocks;
+    };
+
+    static time_t dayStart(time_t time);
+    static std::string tableName(const char *prefix, time_t day);
+    static bool parseTableName(const std::string &name, const char *prefix, time_t &day);
+
+    bool exec(const std::string &sql);
+    bool endTransaction(bool ok);
+    bool hasColumn(const std::string &table, const char *column);
+    void discover();
+    bool ensureRows(time_t day);
+    bool ensureBlocks(time_t day);
+    bool prepareInsert(time_t day);
+    void finalizeInsert();
+    bool compactDay(time_t day);
+    void readBlocks(time_t day, int sensorId, time_t from, time_t to, ReadingSeries &series);
+    void readRows(time_t day, int sensorId, time_t from, time_t to, ReadingSeries &series);
+
+    sqlite3 *db_;
+    std::map<time_t, Partition> partitions_;
+    sqlite3_stmt *insertStmt_;
+    time_t insertDay_;
+    mutable std::mutex mutex_;
+};
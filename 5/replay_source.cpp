@@ -0,0 +1,194 @@
+#include "replay_source.h"
+#include "logger.h"
+#include "sample_parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const size_t chunkSize = 255;
+
+ReplaySource::ReplaySource(const std::string &path)
+    : path_(path), fd_(-1), data_(nullptr), size_(0), offset_(0) {
+}
+
+ReplaySource::~ReplaySource() {
+    closeFile();
+}
+
+bool ReplaySource::openFile() {
+    fd_ = open(path_.c_str(), O_RDONLY);
+    if (fd_ == -1) {
+        std::cerr << "Error opening replay file " << path_ << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        std::cerr << "Error reading replay file size: " << strerror(errno) << std::endl;
+        closeFile();
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    offset_ = 0;
+    if (size_ == 0) {
+        return true;
+    }
+
+    void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Error mapping replay file: " << strerror(errno) << std::endl;
+        size_ = 0;
+        closeFile();
+        return false;
+    }
+    data_ = static_cast<const char *>(mapped);
+    madvise(mapped, size_, MADV_SEQUENTIAL);
+
+    const char *lineEnd = static_cast<const char *>(memchr(data_, '\n', size_));
+    size_t firstLineLength = lineEnd ? static_cast<size_t>(lineEnd - data_) : size_;
+
+    bool header = std::any_of(data_, data_ + firstLineLength, [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    });
+    if (header) {
+        offset_ = lineEnd ? firstLineLength + 1 : size_;
+    }
+
+    return true;
+}
+
+void ReplaySource::closeFile() {
+    if (data_) {
+        munmap(const_cast<char *>(data_), size_);
+        data_ = nullptr;
+    }
+    if (fd_ != -1) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool ReplaySource::isOpen() const {
+    return fd_ != -1;
+}
+
+bool ReplaySource::atEnd() const {
+    return offset_ >= size_;
+}
+
+size_t ReplaySource::getSize() const {
+    return size_;
+}
+
+size_t ReplaySource::readLines(const char *&data) {
+    data = data_ + offset_;
+    if (atEnd()) {
+        return 0;
+    }
+
+    // Runs on to the end of the line the chunk stops in, so the parser never has to
+    // carry a partial line over; only an unterminated last line ends without one.
+    size_t remaining = size_ - offset_;
+    size_t length = std::min(chunkSize, remaining);
+    const char *lineEnd = static_cast<const char *>(memchr(data + length - 1, '\n', remaining - length + 1));
+    length = lineEnd ? static_cast<size_t>(lineEnd - data) + 1 : remaining;
+    offset_ += length;
+    return length;
+}
+
+namespace {
+
+struct StageStats {
+    const char *name;
+    unsigned long long calls;
+    double totalSeconds;
+    double maxSeconds;
+
+    void add(std::chrono::steady_clock::duration elapsed) {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        ++calls;
+        totalSeconds += seconds;
+        maxSeconds = std::max(maxSeconds, seconds);
+    }
+};
+
+}
+
+void runReplay(ReplaySource &source, Logger &logger, VirtualClock &clock, double speed) {
+    SampleParser parser;
+    std::vector<Sample> samples;
+    StageStats stages[] = {{"read", 0, 0.0, 0.0}, {"parse", 0, 0.0, 0.0}, {"log", 0, 0.0, 0.0}, {"update", 0, 0.0, 0.0}};
+
+    bool started = false;
+    time_t simulatedStart = 0;
+    unsigned long long totalSamples = 0;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    while (true) {
+        bool flushing = source.atEnd();
+        auto t0 = std::chrono::steady_clock::now();
+        const char *data = "\n";
+        size_t length = flushing ? 1 : source.readLines(data);
+        auto t1 = std::chrono::steady_clock::now();
+
+        samples.clear();
+        parser.feed(data, length, samples);
+        auto t2 = std::chrono::steady_clock::now();
+
+        for (auto &sample : samples) {
+            if (sample.timestamp == 0) {
+                sample.timestamp = clock.advance();
+            } else {
+                clock.set(sample.timestamp);
+            }
+            if (!started) {
+                simulatedStart = sample.timestamp;
+                wallStart = t0;
+                started = true;
+            }
+            logger.logSample(sample);
+        }
+        auto t3 = std::chrono::steady_clock::now();
+
+        if (!samples.empty()) {
+            logger.updateLogs();
+        }
+        auto t4 = std::chrono::steady_clock::now();
+
+        stages[0].add(t1 - t0);
+        stages[1].add(t2 - t1);
+        stages[2].add(t3 - t2);
+        stages[3].add(t4 - t3);
+        totalSamples += samples.size();
+
+        if (flushing) {
+            break;
+        }
+
+        if (speed > 0 && started) {
+            double simulatedSeconds = static_cast<double>(clock.now() - simulatedStart);
+            std::this_thread::sleep_until(wallStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                          std::chrono::duration<double>(simulatedSeconds / speed)));
+        }
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    std::printf("Replayed %llu samples (%zu bytes, %llu rejected lines) in %.3f s: %.0f samples/s\n",
+                totalSamples, source.getSize(), parser.getRejectedLines(), wallSeconds,
+                wallSeconds > 0 ? totalSamples / wallSeconds : 0.0);
+    std::printf("%-8s %12s %14s %14s\n", "stage", "calls", "mean, us", "max, us");
+    for (const auto &stage : stages) {
+        std::printf("%-8s %12llu %14.2f %14.2f\n", stage.name, stage.calls,
+                    stage.calls ? stage.totalSeconds / stage.calls * 1e6 : 0.0, stage.maxSeconds * 1e6);
+    }
+}
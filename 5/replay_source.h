@@ -0,0 +1,33 @@
+#pragma once
+
+#include "clock.h"
+#include <cstddef>
+#include <string>
+
+class Logger;
+
+// Memory-mapped capture file. Reads hand out whole lines straight from the mapping,
+// about a serial read's worth at a time, so nothing is copied before parsing.
+class ReplaySource {
+public:
+    explicit ReplaySource(const std::string &path);
+    ~ReplaySource();
+
+    bool openFile();
+    void closeFile();
+    bool isOpen() const;
+    bool atEnd() const;
+    size_t getSize() const;
+
+    size_t readLines(const char *&data);
+
+private:
+    std::string path_;
+    int fd_;
+    const char *data_;
+    size_t size_;
+    size_t offset_;
+};
+
+// speed <= 0 replays as fast as the pipeline allows.
+void runReplay(ReplaySource &source, Logger &logger, VirtualClock &clock, double speed);
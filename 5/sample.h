@@ -0,0 +1,16 @@
+#pragma once
+
+#include <ctime>
+
+enum class SampleQuality {
+    Good,
+    Simulated,
+    Suspect
+};
+
+struct Sample {
+    int sensorId;
+    time_t timestamp;
+    double value;
+    SampleQuality quality;
+};
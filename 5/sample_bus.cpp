@@ -0,0 +1,294 @@
+#include "sample_bus.h"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <csignal>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const std::uint32_t busMagic = 0x53425553;
+static const std::uint32_t busVersion = 2;
+// Readers map the bus read-write to register as waiters, so they need write access:
+// readers run as the writer's user or in its group, and nobody else gets in.
+static const mode_t busMode = 0660;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+              "the bus shares atomics between processes");
+
+static size_t busSize(std::uint32_t capacity) {
+    return sizeof(SampleBusHeader) + static_cast<size_t>(capacity) * sizeof(SampleBusSlot);
+}
+
+static SampleBusSlot *busSlots(SampleBusHeader *header) {
+    return reinterpret_cast<SampleBusSlot *>(reinterpret_cast<char *>(header) + sizeof(SampleBusHeader));
+}
+
+// Shared (not FUTEX_PRIVATE) operations, since waiter and waker are different processes.
+static void futexWait(std::atomic<std::uint32_t> &word, std::uint32_t expected, int timeoutMs) {
+    timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+static void futexWakeAll(std::atomic<std::uint32_t> &word) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+SampleBusWriter::SampleBusWriter(const std::string &name, std::uint32_t capacity)
+    : name_(name), capacity_(capacity), mappedSize_(0), header_(nullptr), slots_(nullptr), nextSequence_(0) {
+}
+
+SampleBusWriter::~SampleBusWriter() {
+    close();
+}
+
+bool SampleBusWriter::open() {
+    if (capacity_ == 0 || (capacity_ & (capacity_ - 1)) != 0) {
+        std::cerr << "Sample bus capacity must be a power of two" << std::endl;
+        return false;
+    }
+
+    // A fresh object each run, so readers still attached to an old one see it closed.
+    // An existing one is only replaced once it is stale.
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, busMode);
+    if (fd < 0 && errno == EEXIST) {
+        if (!isStale(name_)) {
+            std::cerr << "Sample bus " << name_ << " is in use by a running writer" << std::endl;
+            return false;
+        }
+        shm_unlink(name_.c_str());
+        fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, busMode);
+    }
+    // shm_open applies the umask, which would usually take the group's write bit.
+    if (fd >= 0 && fchmod(fd, busMode) != 0) {
+        ::close(fd);
+        fd = -1;
+        shm_unlink(name_.c_str());
+    }
+    if (fd < 0) {
+        std::cerr << "Failed to create sample bus " << name_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    mappedSize_ = busSize(capacity_);
+    void *mapping = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(mappedSize_)) == 0) {
+        mapping = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map sample bus " << name_ << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(name_.c_str());
+        return false;
+    }
+
+    // ftruncate zero-fills, which is a valid empty ring; the magic goes in last.
+    header_ = static_cast<SampleBusHeader *>(mapping);
+    slots_ = busSlots(header_);
+    header_->version = busVersion;
+    header_->capacity = capacity_;
+    header_->slotSize = sizeof(SampleBusSlot);
+    header_->writerPid = static_cast<std::int32_t>(getpid());
+    nextSequence_ = 0;
+    header_->magic.store(busMagic, std::memory_order_release);
+    return true;
+}
+
+// A writer killed before close() never sets closed, so its pid is checked as well.
+static bool writerGone(const SampleBusHeader &header) {
+    return header.closed.load(std::memory_order_acquire) != 0 ||
+           (kill(static_cast<pid_t>(header.writerPid), 0) != 0 && errno == ESRCH);
+}
+
+// Stale: left by another version, closed by its writer, or its writer has exited
+// without closing it.
+bool SampleBusWriter::isStale(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return true;
+    }
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SampleBusHeader)) {
+        mapping = mmap(nullptr, sizeof(SampleBusHeader), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return true;
+    }
+
+    const SampleBusHeader *header = static_cast<const SampleBusHeader *>(mapping);
+    bool stale = header->magic.load(std::memory_order_acquire) != busMagic || header->version != busVersion || writerGone(*header);
+    munmap(mapping, sizeof(SampleBusHeader));
+    return stale;
+}
+
+void SampleBusWriter::close() {
+    if (!header_) {
+        return;
+    }
+    header_->closed.store(1, std::memory_order_seq_cst);
+    header_->notify.fetch_add(1, std::memory_order_seq_cst);
+    futexWakeAll(header_->notify);
+    munmap(header_, mappedSize_);
+    shm_unlink(name_.c_str());
+    header_ = nullptr;
+    slots_ = nullptr;
+}
+
+void SampleBusWriter::publish(const Sample &sample) {
+    if (!header_) {
+        return;
+    }
+
+    std::uint64_t sequence = nextSequence_++;
+    SampleBusSlot &slot = slots_[sequence & (capacity_ - 1)];
+    std::uint64_t valueBits;
+    std::memcpy(&valueBits, &sample.value, sizeof(valueBits));
+
+    slot.sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timestamp.store(static_cast<std::int64_t>(sample.timestamp), std::memory_order_relaxed);
+    slot.valueBits.store(valueBits, std::memory_order_relaxed);
+    slot.sensorId.store(sample.sensorId, std::memory_order_relaxed);
+    slot.quality.store(static_cast<std::int32_t>(sample.quality), std::memory_order_relaxed);
+    slot.sequence.store(2 * sequence + 2, std::memory_order_release);
+    header_->writeSequence.store(sequence + 1, std::memory_order_release);
+
+    // Pairs with the waiter's increment of waiters before it rechecks the ring.
+    header_->notify.store(static_cast<std::uint32_t>(sequence + 1), std::memory_order_seq_cst);
+    if (header_->waiters.load(std::memory_order_seq_cst) > 0) {
+        futexWakeAll(header_->notify);
+    }
+}
+
+SampleBusReader::SampleBusReader() : mappedSize_(0), header_(nullptr), slots_(nullptr), cursor_(0), lostSamples_(0) {
+}
+
+SampleBusReader::~SampleBusReader() {
+    close();
+}
+
+bool SampleBusReader::open(const std::string &name, bool fromOldest) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SampleBusHeader)) {
+        mappedSize_ = static_cast<size_t>(info.st_size);
+        // Readers write only the waiter count.
+        mapping = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    header_ = static_cast<SampleBusHeader *>(mapping);
+    if (header_->magic.load(std::memory_order_acquire) != busMagic || header_->version != busVersion ||
+        header_->slotSize != sizeof(SampleBusSlot)) {
+        close();
+        return false;
+    }
+    std::uint32_t capacity = header_->capacity;
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || busSize(capacity) > mappedSize_) {
+        close();
+        return false;
+    }
+    slots_ = busSlots(header_);
+
+    std::uint64_t written = header_->writeSequence.load(std::memory_order_acquire);
+    cursor_ = written;
+    if (fromOldest) {
+        // The oldest slot may be the one being overwritten right now.
+        cursor_ = written > header_->capacity ? written - header_->capacity + 1 : 0;
+    }
+    lostSamples_ = 0;
+    return true;
+}
+
+void SampleBusReader::close() {
+    if (header_) {
+        munmap(header_, mappedSize_);
+    }
+    header_ = nullptr;
+    slots_ = nullptr;
+}
+
+size_t SampleBusReader::read(Sample *samples, size_t maxSamples) {
+    if (!header_) {
+        return 0;
+    }
+
+    std::uint64_t capacity = header_->capacity;
+    std::uint64_t written = header_->writeSequence.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (count < maxSamples && cursor_ < written) {
+        if (written - cursor_ >= capacity) {
+            std::uint64_t oldest = written - capacity + 1;
+            lostSamples_ += oldest - cursor_;
+            cursor_ = oldest;
+            continue;
+        }
+
+        SampleBusSlot &slot = slots_[cursor_ & (capacity - 1)];
+        std::uint64_t expected = 2 * cursor_ + 2;
+        if (slot.sequence.load(std::memory_order_acquire) == expected) {
+            Sample sample;
+            sample.timestamp = static_cast<time_t>(slot.timestamp.load(std::memory_order_relaxed));
+            std::uint64_t valueBits = slot.valueBits.load(std::memory_order_relaxed);
+            sample.sensorId = slot.sensorId.load(std::memory_order_relaxed);
+            sample.quality = static_cast<SampleQuality>(slot.quality.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+                std::memcpy(&sample.value, &valueBits, sizeof(valueBits));
+                samples[count++] = sample;
+                ++cursor_;
+                continue;
+            }
+        }
+
+        // Overwritten before or while it was read: the writer is a full ring ahead.
+        written = header_->writeSequence.load(std::memory_order_acquire);
+        std::uint64_t oldest = written >= capacity ? written - capacity + 1 : 0;
+        lostSamples_ += oldest > cursor_ ? oldest - cursor_ : 1;
+        cursor_ = oldest > cursor_ ? oldest : cursor_ + 1;
+    }
+    return count;
+}
+
+bool SampleBusReader::wait(int timeoutMs) {
+    if (!header_) {
+        return false;
+    }
+    header_->waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::uint32_t notify = header_->notify.load(std::memory_order_seq_cst);
+    bool ready = header_->writeSequence.load(std::memory_order_acquire) > cursor_ || isClosed();
+    if (!ready) {
+        futexWait(header_->notify, notify, timeoutMs);
+        ready = header_->writeSequence.load(std::memory_order_acquire) > cursor_;
+    }
+    header_->waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return ready;
+}
+
+bool SampleBusReader::isClosed() const {
+    return !header_ || header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool SampleBusReader::isWriterAlive() const {
+    return header_ && !writerGone(*header_);
+}
+
+unsigned long long SampleBusReader::getLostSamples() const {
+    return lostSamples_;
+}
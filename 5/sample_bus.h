@@ -0,0 +1,80 @@
+#pragma once
+
+#include "sample.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Live sample stream in POSIX shared memory for local readers. One writer (the ingest
+// process) publishes into a ring of fixed slots; every sample gets the next sequence
+// number. Each slot is a seqlock: its sequence is odd while being written, so readers
+// never lock and can tell a slot overwritten under them. A reader that falls more than
+// a ring behind skips ahead and counts the samples it lost. Waiting readers sleep on a
+// futex in the mapping; the writer only makes the wake syscall when one is waiting.
+struct SampleBusSlot {
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::int64_t> timestamp;
+    std::atomic<std::uint64_t> valueBits;
+    std::atomic<std::int32_t> sensorId;
+    std::atomic<std::int32_t> quality;
+};
+
+struct SampleBusHeader {
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t version;
+    std::uint32_t capacity;
+    std::uint32_t slotSize;
+    std::int32_t writerPid;
+    alignas(64) std::atomic<std::uint64_t> writeSequence;
+    alignas(64) std::atomic<std::uint32_t> notify;
+    std::atomic<std::uint32_t> waiters;
+    std::atomic<std::uint32_t> closed;
+};
+
+class SampleBusWriter {
+public:
+    SampleBusWriter(const std::string &name, std::uint32_t capacity);
+    ~SampleBusWriter();
+
+    // Fails if a writer that is still running owns the name.
+    bool open();
+    void close();
+    void publish(const Sample &sample);
+
+private:
+    static bool isStale(const std::string &name);
+
+    std::string name_;
+    std::uint32_t capacity_;
+    size_t mappedSize_;
+    SampleBusHeader *header_;
+    SampleBusSlot *slots_;
+    std::uint64_t nextSequence_;
+};
+
+class SampleBusReader {
+public:
+    SampleBusReader();
+    ~SampleBusReader();
+
+    // Starts at the next sample published, or with fromOldest at the oldest one kept.
+    bool open(const std::string &name, bool fromOldest = false);
+    void close();
+
+    size_t read(Sample *samples, size_t maxSamples);
+    // Sleeps until a sample is ready, the writer closes or the timeout passes.
+    bool wait(int timeoutMs);
+    bool isClosed() const;
+    // False once the writer has closed the bus or exited without closing it; a restarted
+    // writer publishes on a new bus under the same name, so the reader has to reopen.
+    bool isWriterAlive() const;
+    unsigned long long getLostSamples() const;
+
+private:
+    size_t mappedSize_;
+    SampleBusHeader *header_;
+    SampleBusSlot *slots_;
+    std::uint64_t cursor_;
+    unsigned long long lostSamples_;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "sample.h"
+#include "temperature_parser.h"
+#include <string>
+#include <vector>
+
+class SampleParser {
+public:
+    explicit SampleParser(int sensorId = 0);
+
+    size_t feed(const char *data, size_t size, std::vector<Sample> &samples);
+    size_t feed(const std::string &data, std::vector<Sample> &samples);
+    unsigned long long getRejectedLines() const;
+
+private:
+    void parseLine(const char *begin, const char *end, std::vector<Sample> &samples);
+    static ParseStatus parseTimestamp(const char *begin, const char *end, time_t &timestamp);
+
+    int sensorId_;
+    std::string pending_;
+    unsigned long long rejectedLines_;
+};
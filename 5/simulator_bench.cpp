@@ -0,0 +1,76 @@
+#include "logger.h"
+#include "simulator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+    size_t sensors = 100;
+    size_t steps = 100000;
+    time_t period = 1;
+    bool useLogger = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+            sensors = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+            period = static_cast<time_t>(std::strtol(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--logger") == 0) {
+            useLogger = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--sensors N] [--steps N] [--period SECONDS] [--logger]" << std::endl;
+            return 1;
+        }
+    }
+
+    Simulator simulator(42);
+    time_t start = time(nullptr) - static_cast<time_t>(steps) * period;
+    SensorProfile profile = defaultSensorProfile();
+    for (size_t i = 0; i < sensors; ++i) {
+        profile.baseTemperature = 15.0 + static_cast<double>(i % 20);
+        profile.driftPerDay = (static_cast<double>(i % 7) - 3.0) * 0.01;
+        simulator.addSensor(profile, start);
+    }
+
+    const size_t batchSteps = 1024;
+    std::vector<Sample> batch(batchSteps * sensors);
+    double checksum = 0.0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t step = 0; step < steps; step += batchSteps) {
+        size_t count = std::min(batchSteps, steps - step);
+        simulator.generate(start + static_cast<time_t>(step) * period, period, count, batch.data());
+        for (size_t i = 0; i < count * sensors; ++i) {
+            checksum += batch[i].value;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    size_t total = steps * sensors;
+    std::printf("generated %zu samples in %.3f s (%.1f M samples/s, checksum %.3f)\n",
+                total, seconds, total / seconds / 1e6, checksum);
+
+    if (useLogger) {
+        std::remove("simulator_bench.db");
+        Logger logger("simulator_bench.db");
+        Simulator single(42);
+        single.addSensor(defaultSensorProfile(), start);
+
+        std::vector<Sample> samples;
+        single.generate(start, period, steps, samples);
+
+        begin = std::chrono::steady_clock::now();
+        for (const auto &sample : samples) {
+            logger.logSample(sample);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::printf("logged %zu samples in %.3f s (%.0f samples/s)\n", samples.size(), seconds, samples.size() / seconds);
+    }
+
+    return 0;
+}
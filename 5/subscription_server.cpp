@@ -0,0 +1,349 @@
+#include "subscription_server.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const size_t maxClientInput = 64 * 1024;
+// A client this far behind is dropped rather than buffered for without limit.
+static const size_t maxClientOutput = 16 * 1024 * 1024;
+static const size_t snapshotChunk = 256 * 1024;
+static const int maxClients = 16;
+static const int liveKind = 3;
+
+static char seriesCode(SeriesKind kind) {
+    switch (kind) {
+    case SeriesKind::Readings:
+        return 'r';
+    case SeriesKind::HourlyAverages:
+        return 'h';
+    case SeriesKind::DailyAverages:
+        return 'd';
+    }
+    return 'r';
+}
+
+static void appendPoint(std::string &out, SeriesKind kind, time_t time, double value) {
+    char line[64];
+    int length = std::snprintf(line, sizeof(line), "%c %lld %.10g\n", seriesCode(kind), static_cast<long long>(time), value);
+    out.append(line, static_cast<size_t>(length));
+}
+
+static void appendExpiry(std::string &out, SeriesKind kind, time_t before) {
+    char line[64];
+    int length = std::snprintf(line, sizeof(line), "x %c %lld\n", seriesCode(kind), static_cast<long long>(before));
+    out.append(line, static_cast<size_t>(length));
+}
+
+static bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+SubscriptionServer::SubscriptionServer(const std::string &socketPath, Logger &logger)
+    : socketPath_(socketPath), logger_(logger), listenFd_(-1), wakeFds_{-1, -1}, stopping_(false), expiredPoints_{0, 0, 0} {
+}
+
+SubscriptionServer::~SubscriptionServer() {
+    stop();
+}
+
+bool SubscriptionServer::start() {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath_.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath_ << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, socketPath_.c_str());
+
+    listenFd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd_ < 0 || pipe(wakeFds_) != 0) {
+        std::cerr << "Failed to create subscription socket: " << std::strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    // A socket left by a previous run would make bind fail.
+    unlink(socketPath_.c_str());
+    if (bind(listenFd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listenFd_, maxClients) != 0 ||
+        !setNonBlocking(listenFd_) || !setNonBlocking(wakeFds_[0]) || !setNonBlocking(wakeFds_[1])) {
+        std::cerr << "Failed to listen on " << socketPath_ << ": " << std::strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    stopping_ = false;
+    thread_ = std::thread(&SubscriptionServer::run, this);
+    return true;
+}
+
+void SubscriptionServer::stop() {
+    if (thread_.joinable()) {
+        stopping_ = true;
+        wake();
+        thread_.join();
+    }
+    for (const auto &client : clients_) {
+        close(client.fd);
+    }
+    clients_.clear();
+    if (listenFd_ >= 0) {
+        close(listenFd_);
+        unlink(socketPath_.c_str());
+        listenFd_ = -1;
+    }
+    for (int &fd : wakeFds_) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+void SubscriptionServer::seriesAppended(SeriesKind kind, time_t time, double value) {
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex_);
+        events_.push_back(Event{kind, false, time, value});
+    }
+    wake();
+}
+
+void SubscriptionServer::seriesExpired(SeriesKind kind, time_t before) {
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex_);
+        events_.push_back(Event{kind, true, before, 0.0});
+    }
+    wake();
+}
+
+void SubscriptionServer::wake() {
+    if (wakeFds_[1] < 0) {
+        return;
+    }
+    // A full pipe already has a wakeup pending.
+    char byte = 1;
+    ssize_t written = write(wakeFds_[1], &byte, 1);
+    (void)written;
+}
+
+void SubscriptionServer::run() {
+    std::vector<pollfd> fds;
+    while (!stopping_) {
+        fds.clear();
+        fds.push_back(pollfd{listenFd_, POLLIN, 0});
+        fds.push_back(pollfd{wakeFds_[0], POLLIN, 0});
+        for (const auto &client : clients_) {
+            bool pending = !client.output.empty() || client.snapshotKind != liveKind;
+            fds.push_back(pollfd{client.fd, static_cast<short>(POLLIN | (pending ? POLLOUT : 0)), 0});
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Subscription poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char buffer[256];
+            while (read(wakeFds_[0], buffer, sizeof(buffer)) > 0) {
+            }
+        }
+        applyEvents();
+
+        std::vector<Client> alive;
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            Client &client = clients_[i];
+            short revents = fds[i + 2].revents;
+            bool keep = !(revents & (POLLERR | POLLNVAL));
+            if (keep && (revents & (POLLIN | POLLHUP))) {
+                keep = readClient(client);
+            }
+            if (keep && client.snapshotKind != liveKind) {
+                fillSnapshot(client);
+            }
+            if (keep && !client.output.empty()) {
+                keep = writeClient(client) && client.output.size() <= maxClientOutput;
+            }
+            if (keep) {
+                alive.push_back(std::move(client));
+            } else {
+                close(client.fd);
+            }
+        }
+        clients_.swap(alive);
+
+        if (fds[0].revents & POLLIN) {
+            acceptClient();
+        }
+    }
+}
+
+void SubscriptionServer::applyEvents() {
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex_);
+        events.swap(events_);
+    }
+    if (events.empty()) {
+        return;
+    }
+
+    std::string out;
+    std::string line;
+    for (const auto &event : events) {
+        int kind = static_cast<int>(event.kind);
+        Series &series = getSeries(event.kind);
+        line.clear();
+        if (event.expired) {
+            while (!series.empty() && series.front().first < event.time) {
+                series.pop_front();
+                ++expiredPoints_[kind];
+            }
+            appendExpiry(line, event.kind, event.time);
+        } else {
+            series.push_back(std::make_pair(event.time, event.value));
+            appendPoint(line, event.kind, event.time, event.value);
+        }
+        out += line;
+
+        // Mid-snapshot, appends to a series not finished yet are still sent from the
+        // mirror; expiries only matter for points already sent.
+        for (auto &client : clients_) {
+            if (client.snapshotKind != liveKind &&
+                (kind < client.snapshotKind || (event.expired && kind == client.snapshotKind))) {
+                client.output += line;
+            }
+        }
+    }
+    for (auto &client : clients_) {
+        if (client.snapshotKind == liveKind) {
+            client.output += out;
+        }
+    }
+}
+
+void SubscriptionServer::acceptClient() {
+    int fd;
+    while ((fd = accept(listenFd_, nullptr, nullptr)) >= 0) {
+        if (clients_.size() >= static_cast<size_t>(maxClients) || !setNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+
+        Client client;
+        client.fd = fd;
+        char hello[96];
+        std::snprintf(hello, sizeof(hello), "hello 1 %lld %lld\n",
+                      static_cast<long long>(logger_.getRollupRetention(RollupLevel::Minute)),
+                      static_cast<long long>(logger_.getRollupRetention(RollupLevel::Hour)));
+        client.output = hello;
+        client.snapshotKind = 0;
+        client.snapshotNext = expiredPoints_[0];
+        fillSnapshot(client);
+
+        if (writeClient(client)) {
+            clients_.push_back(std::move(client));
+        } else {
+            close(fd);
+        }
+    }
+}
+
+bool SubscriptionServer::readClient(Client &client) {
+    char buffer[4096];
+    while (true) {
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            client.input.append(buffer, static_cast<size_t>(received));
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        }
+        return false;
+    }
+
+    size_t start = 0;
+    size_t end;
+    while ((end = client.input.find('\n', start)) != std::string::npos) {
+        handleRequest(client, client.input.substr(start, end - start));
+        start = end + 1;
+    }
+    client.input.erase(0, start);
+    return client.input.size() <= maxClientInput;
+}
+
+bool SubscriptionServer::writeClient(Client &client) {
+    while (!client.output.empty()) {
+        ssize_t sent = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (sent > 0) {
+            client.output.erase(0, static_cast<size_t>(sent));
+            continue;
+        }
+        return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    }
+    return true;
+}
+
+void SubscriptionServer::fillSnapshot(Client &client) {
+    while (client.snapshotKind != liveKind && client.output.size() < snapshotChunk) {
+        SeriesKind kind = static_cast<SeriesKind>(client.snapshotKind);
+        const Series &series = getSeries(kind);
+        unsigned long long expired = expiredPoints_[client.snapshotKind];
+        size_t i = client.snapshotNext > expired ? static_cast<size_t>(client.snapshotNext - expired) : 0;
+        for (; i < series.size() && client.output.size() < snapshotChunk; ++i) {
+            appendPoint(client.output, kind, series[i].first, series[i].second);
+        }
+        client.snapshotNext = expired + i;
+        if (i < series.size()) {
+            break;
+        }
+
+        if (++client.snapshotKind == liveKind) {
+            client.output += "live\n";
+        } else {
+            client.snapshotNext = expiredPoints_[client.snapshotKind];
+        }
+    }
+}
+
+void SubscriptionServer::handleRequest(Client &client, const std::string &line) {
+    int level = 0;
+    long long from = 0;
+    long long to = 0;
+    if (std::sscanf(line.c_str(), "rollups %d %lld %lld", &level, &from, &to) != 3 || level < 0 || level > 2) {
+        client.output += "error unknown request\n";
+        return;
+    }
+
+    RollupLevel rollupLevel = static_cast<RollupLevel>(level);
+    time_t half = rollupLevelSeconds(rollupLevel) / 2;
+    char header[64];
+    std::snprintf(header, sizeof(header), "tile %d %lld", level, from);
+    client.output += header;
+    for (const auto &bucket : logger_.getRollups(rollupLevel, static_cast<time_t>(from), static_cast<time_t>(to))) {
+        char point[64];
+        std::snprintf(point, sizeof(point), " %lld,%.10g", static_cast<long long>(bucket.start + half), bucket.mean());
+        client.output += point;
+    }
+    client.output += "\n";
+}
+
+SubscriptionServer::Series &SubscriptionServer::getSeries(SeriesKind kind) {
+    switch (kind) {
+    case SeriesKind::Readings:
+        return readings_;
+    case SeriesKind::HourlyAverages:
+        return hourlyAverages_;
+    case SeriesKind::DailyAverages:
+        return dailyAverages_;
+    }
+    return readings_;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "logger.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Serves Logger's in-memory series to local clients over a Unix domain socket, so a GUI
+// can follow the same ingest pipeline as the HTTP server instead of opening the database
+// itself. The protocol is line-based text. Every client first gets
+//   hello 1 MINUTE_RETENTION HOUR_RETENTION
+// then the current series as "r|h|d TIME VALUE" lines and "live". After that it gets
+// every change as it happens: appends in the same form and "x r|h|d TIME" to drop points
+// older than TIME. A client may send "rollups LEVEL FROM TO" (LEVEL 0 minute, 1 hour,
+// 2 day); the answer is "tile LEVEL FROM X,MEAN..." with X at the bucket middle.
+class SubscriptionServer : public SeriesListener {
+public:
+    SubscriptionServer(const std::string &socketPath, Logger &logger);
+    ~SubscriptionServer() override;
+
+    bool start();
+    void stop();
+
+    void seriesAppended(SeriesKind kind, time_t time, double value) override;
+    void seriesExpired(SeriesKind kind, time_t before) override;
+
+private:
+    struct Event {
+        SeriesKind kind;
+        bool expired;
+        time_t time;
+        double value;
+    };
+
+    // The snapshot is written out a chunk at a time as the socket drains, from the mirror
+    // itself, so only live changes count against the output limit. snapshotKind is the
+    // series being sent (all three done: live) and snapshotNext the index of its next
+    // point, counted from the first point the mirror ever held.
+    struct Client {
+        int fd;
+        std::string input;
+        std::string output;
+        int snapshotKind;
+        unsigned long long snapshotNext;
+    };
+
+    typedef std::deque<std::pair<time_t, double>> Series;
+
+    void run();
+    void wake();
+    void applyEvents();
+    void acceptClient();
+    bool readClient(Client &client);
+    bool writeClient(Client &client);
+    void fillSnapshot(Client &client);
+    void handleRequest(Client &client, const std::string &line);
+    Series &getSeries(SeriesKind kind);
+
+    std::string socketPath_;
+    Logger &logger_;
+    int listenFd_;
+    int wakeFds_[2];
+    std::thread thread_;
+    std::atomic<bool> stopping_;
+
+    std::mutex eventsMutex_;
+    std::vector<Event> events_;
+
+    // Mirrors Logger's series as of the events applied so far; only the server thread uses it.
+    Series readings_;
+    Series hourlyAverages_;
+    Series dailyAverages_;
+    unsigned long long expiredPoints_[3];
+    std::vector<Client> clients_;
+};
@@ -0,0 +1,184 @@
+#include "tdigest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+static const size_t headerSize = 2 + 2 * sizeof(double);
+static const size_t centroidSize = sizeof(float) + sizeof(std::uint32_t);
+
+// Scale function k1: centroids stay small near the tails and grow towards the median.
+static double scale(double q, double compression) {
+    return compression / (2.0 * M_PI) * std::asin(2.0 * q - 1.0);
+}
+
+static double scaleInverse(double k, double compression) {
+    double angle = std::min(M_PI / 2.0, k * 2.0 * M_PI / compression);
+    return (std::sin(angle) + 1.0) / 2.0;
+}
+
+TDigest::TDigest(double compression)
+    : compression_(compression), totalWeight_(0.0), min_(std::numeric_limits<double>::infinity()),
+      max_(-std::numeric_limits<double>::infinity()) {
+}
+
+void TDigest::add(double value, double weight) {
+    if (!std::isfinite(value) || weight <= 0.0) {
+        return;
+    }
+
+    Centroid centroid = {value, weight};
+    buffer_.push_back(centroid);
+    totalWeight_ += weight;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+
+    if (buffer_.size() >= static_cast<size_t>(compression_) * 5) {
+        compress();
+    }
+}
+
+void TDigest::merge(const TDigest &other) {
+    if (other.empty()) {
+        return;
+    }
+
+    other.compress();
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    totalWeight_ += other.totalWeight_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    compress();
+}
+
+void TDigest::clear() {
+    centroids_.clear();
+    buffer_.clear();
+    totalWeight_ = 0.0;
+    min_ = std::numeric_limits<double>::infinity();
+    max_ = -std::numeric_limits<double>::infinity();
+}
+
+bool TDigest::empty() const {
+    return totalWeight_ <= 0.0;
+}
+
+double TDigest::count() const {
+    return totalWeight_;
+}
+
+double TDigest::quantile(double q) const {
+    if (empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    compress();
+
+    q = std::min(1.0, std::max(0.0, q));
+    if (centroids_.size() == 1) {
+        return centroids_.front().mean;
+    }
+
+    // Each centroid's mass is centred on its mean; interpolate between neighbouring centres
+    // and towards the exact min and max at the ends.
+    double target = q * totalWeight_;
+    double cumulative = centroids_.front().weight / 2.0;
+    if (target < cumulative) {
+        double fraction = cumulative > 0.0 ? target / cumulative : 0.0;
+        return min_ + fraction * (centroids_.front().mean - min_);
+    }
+
+    for (size_t i = 0; i + 1 < centroids_.size(); ++i) {
+        double step = (centroids_[i].weight + centroids_[i + 1].weight) / 2.0;
+        if (target < cumulative + step) {
+            double fraction = (target - cumulative) / step;
+            return centroids_[i].mean + fraction * (centroids_[i + 1].mean - centroids_[i].mean);
+        }
+        cumulative += step;
+    }
+
+    double tail = centroids_.back().weight / 2.0;
+    double fraction = tail > 0.0 ? std::min(1.0, (target - cumulative) / tail) : 1.0;
+    return centroids_.back().mean + fraction * (max_ - centroids_.back().mean);
+}
+
+void TDigest::serialize(std::string &out) const {
+    compress();
+
+    std::uint16_t count = static_cast<std::uint16_t>(centroids_.size());
+    char header[headerSize];
+    std::memcpy(header, &count, 2);
+    std::memcpy(header + 2, &min_, sizeof(double));
+    std::memcpy(header + 2 + sizeof(double), &max_, sizeof(double));
+    out.append(header, sizeof(header));
+
+    for (const auto &centroid : centroids_) {
+        float mean = static_cast<float>(centroid.mean);
+        std::uint32_t weight = static_cast<std::uint32_t>(std::lround(centroid.weight));
+        char packed[centroidSize];
+        std::memcpy(packed, &mean, sizeof(mean));
+        std::memcpy(packed + sizeof(mean), &weight, sizeof(weight));
+        out.append(packed, sizeof(packed));
+    }
+}
+
+bool TDigest::deserialize(const char *data, size_t size) {
+    clear();
+    if (size < headerSize) {
+        return false;
+    }
+
+    std::uint16_t count;
+    std::memcpy(&count, data, 2);
+    if (size != headerSize + count * centroidSize) {
+        return false;
+    }
+    std::memcpy(&min_, data + 2, sizeof(double));
+    std::memcpy(&max_, data + 2 + sizeof(double), sizeof(double));
+
+    const char *p = data + headerSize;
+    for (std::uint16_t i = 0; i < count; ++i, p += centroidSize) {
+        float mean;
+        std::uint32_t weight;
+        std::memcpy(&mean, p, sizeof(mean));
+        std::memcpy(&weight, p + sizeof(mean), sizeof(weight));
+        Centroid centroid = {mean, static_cast<double>(weight)};
+        centroids_.push_back(centroid);
+        totalWeight_ += weight;
+    }
+    return true;
+}
+
+void TDigest::compress() const {
+    if (buffer_.empty()) {
+        return;
+    }
+
+    buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+    std::sort(buffer_.begin(), buffer_.end(), [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+    centroids_.clear();
+
+    double total = 0.0;
+    for (const auto &centroid : buffer_) {
+        total += centroid.weight;
+    }
+
+    Centroid current = buffer_.front();
+    double weightSoFar = 0.0;
+    double limit = total * scaleInverse(scale(0.0, compression_) + 1.0, compression_);
+    for (size_t i = 1; i < buffer_.size(); ++i) {
+        const Centroid &next = buffer_[i];
+        if (weightSoFar + current.weight + next.weight <= limit) {
+            current.mean += (next.mean - current.mean) * next.weight / (current.weight + next.weight);
+            current.weight += next.weight;
+            continue;
+        }
+
+        weightSoFar += current.weight;
+        centroids_.push_back(current);
+        current = next;
+        limit = total * scaleInverse(scale(weightSoFar / total, compression_) + 1.0, compression_);
+    }
+    centroids_.push_back(current);
+    buffer_.clear();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Merging t-digest (Dunning). Sketches of disjoint buckets merge into a sketch of their
+// union, so range quantiles come from stored per-bucket sketches alone.
+class TDigest {
+public:
+    explicit TDigest(double compression = 100.0);
+
+    void add(double value, double weight = 1.0);
+    void merge(const TDigest &other);
+    void clear();
+
+    bool empty() const;
+    double count() const;
+    double quantile(double q) const;
+
+    void serialize(std::string &out) const;
+    bool deserialize(const char *data, size_t size);
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+
+    void compress() const;
+
+    double compression_;
+    mutable std::vector<Centroid> centroids_;
+    mutable std::vector<Centroid> buffer_;
+    double totalWeight_;
+    double min_;
+    double max_;
+};
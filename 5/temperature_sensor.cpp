@@ -1,19 +1,17 @@
 #include "temperature_sensor.h"
-#include <iomanip>
-#include <random>
-#include <sstream>
 
-TemperatureSensor::TemperatureSensor() : currentTemperature_(20.0) {
+TemperatureSensor::TemperatureSensor(int sensorId, std::uint64_t seed) : sensorId_(sensorId), simulator_(seed) {
+    simulator_.addSensor(defaultSensorProfile(), time(nullptr));
 }
 
-std::string TemperatureSensor::getTemperature() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::normal_distribution<> distrib(0, 0.5);
-
-    currentTemperature_ += distrib(gen);
+Sample TemperatureSensor::getSample() {
+    Sample sample = getSample(time(nullptr));
+    sample.timestamp = 0;
+    return sample;
+}
 
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(1) << currentTemperature_;
-    return ss.str();
+Sample TemperatureSensor::getSample(time_t timestamp) {
+    Sample sample = simulator_.generateOne(0, timestamp);
+    sample.sensorId = sensorId_;
+    return sample;
 }
\ No newline at end of file
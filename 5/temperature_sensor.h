@@ -1,10 +1,12 @@
-#include <string>
+#include "simulator.h"
 
 class TemperatureSensor {
 public:
-    TemperatureSensor();
-    std::string getTemperature();
+    explicit TemperatureSensor(int sensorId = 0, std::uint64_t seed = 1);
+    Sample getSample();
+    Sample getSample(time_t timestamp);
 
 private:
-    double currentTemperature_;
+    int sensorId_;
+    Simulator simulator_;
 };
\ No newline at end of file
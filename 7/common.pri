@@ -0,0 +1,51 @@
+SOURCES += \
+    $$PWD/src/logger.cpp \
+    $$PWD/src/serial_port.cpp \
+    $$PWD/src/temperature_sensor.cpp \
+    $$PWD/src/mainwindow.cpp \
+    $$PWD/src/plot.cpp \
+    $$PWD/src/data_worker.cpp \
+    $$PWD/src/hub_client.cpp \
+    $$PWD/src/acquisition_thread.cpp \
+    $$PWD/src/temperature_parser.cpp \
+    $$PWD/src/sample_parser.cpp \
+    $$PWD/src/simulator.cpp \
+    $$PWD/src/clock.cpp \
+    $$PWD/src/snapshot.cpp \
+    $$PWD/src/compressed_block.cpp \
+    $$PWD/src/reading_partitions.cpp \
+    $$PWD/src/rollups.cpp \
+    $$PWD/src/tdigest.cpp
+
+HEADERS += \
+  $$PWD/include/logger.h \
+  $$PWD/include/serial_port.h \
+  $$PWD/include/temperature_sensor.h \
+  $$PWD/include/mainwindow.h \
+  $$PWD/include/plot.h \
+  $$PWD/include/data_worker.h \
+  $$PWD/include/hub_client.h \
+  $$PWD/include/acquisition_thread.h \
+  $$PWD/include/temperature_parser.h \
+  $$PWD/include/sample.h \
+  $$PWD/include/sample_parser.h \
+  $$PWD/include/simulator.h \
+  $$PWD/include/clock.h \
+  $$PWD/include/snapshot.h \
+  $$PWD/include/compressed_block.h \
+  $$PWD/include/reading_partitions.h \
+  $$PWD/include/rollups.h \
+  $$PWD/include/tdigest.h
+
+QT += widgets network
+# std::from_chars in temperature_parser.cpp needs C++17.
+CONFIG += c++17
+QMAKE_CXXFLAGS += -DUSE_SIMULATION
+
+unix{
+LIBS += -lqwt-qt5 -lsqlite3
+INCLUDEPATH += usr/include/qwt/
+DEPENDPATH += usr/include/qwt/
+CONFIG += qwt
+CONFIG += svg
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QThread>
+#include <QVector>
+#include "data_worker.h"
+#include "sample_parser.h"
+#include "serial_port.h"
+#include "temperature_sensor.h"
+
+// Reads the sensor (the serial port, or the simulator under USE_SIMULATION) on its own
+// thread. Samples are batched and handed on, with the latest value, at most once per
+// display interval, so a burst of lines costs the GUI one event.
+class AcquisitionThread : public QThread {
+    Q_OBJECT
+public:
+    explicit AcquisitionThread(const std::string &portName, QObject *parent = nullptr);
+    ~AcquisitionThread() override;
+
+signals:
+    void samplesAcquired(const QVector<Sample> &samples);
+    void latestValue(double value);
+
+protected:
+    void run() override;
+
+private:
+    void waitInterruptible(int milliseconds);
+
+    SerialPort serialPort_;
+    TemperatureSensor sensor_;
+    SampleParser parser_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// Gorilla-style block: delta-of-delta timestamps and XOR-encoded doubles behind a
+// 20-byte header (point count, first and last timestamp) so readers can skip blocks
+// outside a query range without touching the bitstream.
+static const size_t compressedBlockHeaderSize = 20;
+
+struct CompressedBlockInfo {
+    std::uint32_t count;
+    time_t firstTime;
+    time_t lastTime;
+};
+
+class BlockEncoder {
+public:
+    BlockEncoder();
+
+    void clear();
+    bool append(time_t time, double value);
+
+    size_t size() const;
+    time_t firstTime() const;
+    time_t lastTime() const;
+    size_t encodedSize() const;
+    void encode(std::string &out) const;
+
+private:
+    void writeBits(std::uint64_t bits, int count);
+
+    std::string stream_;
+    int freeBits_;
+    std::uint32_t count_;
+    time_t firstTime_;
+    time_t lastTime_;
+    std::int64_t lastDelta_;
+    std::uint64_t lastValue_;
+    int lastLeading_;
+    int lastTrailing_;
+};
+
+class BlockDecoder {
+public:
+    BlockDecoder(const char *data, size_t size);
+
+    bool isValid() const;
+    const CompressedBlockInfo &info() const;
+    bool next(time_t &time, double &value);
+
+private:
+    bool readBits(int count, std::uint64_t &bits);
+
+    const unsigned char *data_;
+    const unsigned char *end_;
+    std::uint64_t buffer_;
+    int available_;
+    bool valid_;
+    CompressedBlockInfo info_;
+    std::uint32_t decoded_;
+    time_t time_;
+    std::int64_t delta_;
+    std::uint64_t value_;
+    int leading_;
+    int trailing_;
+};
+
+bool readCompressedBlockInfo(const char *data, size_t size, CompressedBlockInfo &info);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QMetaType>
+#include <QObject>
+#include <QPointF>
+#include <QVector>
+#include "logger.h"
+#include "sample.h"
+
+Q_DECLARE_METATYPE(Sample)
+
+// Owns every Logger write once moved to its thread: samples arrive through queued
+// signals, and refresh() does the database work off the GUI thread. The plots read
+// Logger's in-memory series directly, so a refresh only announces that they changed.
+class DataWorker : public QObject {
+    Q_OBJECT
+public:
+    explicit DataWorker(Logger &logger, QObject *parent = nullptr);
+
+public slots:
+    void logSamples(const QVector<Sample> &samples);
+    void refresh();
+    void loadDetail(int level, qint64 from, qint64 to);
+
+signals:
+    void seriesUpdated();
+    void detailLoaded(int level, qint64 from, const QVector<QPointF> &points);
+
+private:
+    Logger &logger_;
+};
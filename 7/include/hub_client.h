@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QByteArray>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointF>
+#include <QString>
+#include <QVector>
+#include <shared_mutex>
+#include "snapshot.h"
+
+// Follows the series that the HTTP server in 5/ publishes on its Unix domain socket, so
+// the GUI shares that process's ingest instead of reading the sensor and writing the
+// database itself. The series are rebuilt from the snapshot sent on every (re)connect
+// and then kept up to date from pushed lines; rollup tiles are requested on the same
+// connection.
+class HubClient : public QObject {
+    Q_OBJECT
+public:
+    explicit HubClient(const QString &socketPath, QObject *parent = nullptr);
+
+    void start();
+
+    // Only changed on the GUI thread, under an exclusive lock on getSeriesMutex().
+    std::shared_mutex &getSeriesMutex() const;
+    const ReadingSeries &getReadingSeries() const;
+    const ReadingSeries &getHourlyAverageSeries() const;
+    const ReadingSeries &getDailyAverageSeries() const;
+
+public slots:
+    void loadDetail(int level, qint64 from, qint64 to);
+
+signals:
+    void connected(qint64 minuteRetention, qint64 hourRetention);
+    void seriesUpdated();
+    void latestValue(double value);
+    void detailLoaded(int level, qint64 from, const QVector<QPointF> &points);
+
+private slots:
+    void connectToHub();
+    void readLines();
+    void scheduleReconnect();
+
+private:
+    bool handleLine(const QByteArray &line);
+    ReadingSeries *getSeries(const QByteArray &code);
+
+    QString socketPath_;
+    QLocalSocket socket_;
+    bool live_;
+    bool reconnectPending_;
+    mutable std::shared_mutex seriesMutex_;
+    ReadingSeries readings_;
+    ReadingSeries hourlyAverages_;
+    ReadingSeries dailyAverages_;
+};
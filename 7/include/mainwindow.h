@@ -1,13 +1,17 @@
+#pragma once
+
 #include <QMainWindow>
 #include <QLabel>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QKeyEvent>
 #include <QCloseEvent>
+#include <QThread>
+#include "acquisition_thread.h"
+#include "data_worker.h"
+#include "hub_client.h"
 #include "logger.h"
 #include "plot.h"
-#include "serial_port.h"
-#include "temperature_sensor.h"
 
 class MainWindow : public QMainWindow
 {
@@ -15,25 +19,34 @@ class MainWindow : public QMainWindow
 
 public:
     MainWindow(Logger &logger, QWidget *parent = nullptr);
+    MainWindow(HubClient &hub, QWidget *parent = nullptr);
     ~MainWindow() override;
 
+signals:
+    void refreshRequested();
+
 private slots:
-    void updateDisplay();
+    void showLatestValue(double value);
     void updateReadings();
-
+    void scheduleRefresh();
+    void refreshPlots();
 
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
 
 private:
-    Logger &logger_;
+    void createPlots(const ReadingSeries &readings, const ReadingSeries &hourlyAverages, const ReadingSeries &dailyAverages,
+                     std::shared_mutex &mutex);
+
+    QThread workerThread_;
+    DataWorker *worker_;
+    bool refreshPending_;
     QLabel *currentTempLabel_;
-    QTimer *timer_;
     QTimer *updateTimer_;
     Plot *plotAll_;
     Plot *plotHourly_;
     Plot *plotDaily_;
-    SerialPort serialPort_;
-    TemperatureSensor sensor_;
+    // Only the window that owns the Logger reads the sensor.
+    AcquisitionThread *acquisition_;
 };
\ No newline at end of file
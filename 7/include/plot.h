@@ -1,16 +1,111 @@
+#pragma once
+
 #include <QDateTime>
+#include <QMap>
+#include <QPair>
+#include <QPointF>
+#include <QSet>
 #include <QVector>
 #include <qwt_plot.h>
 #include <qwt_plot_curve.h>
+#include <qwt_plot_zoomer.h>
+#include <qwt_series_data.h>
 #include <qwt_symbol.h>
+#include "logger.h"
+
+// Zero-copy view of one of Logger's in-memory series. sample() reads the deque itself, so
+// it is only used while SeriesCurve holds Logger's series lock. update() refreshes the
+// cached bounds from the points added since the last call; it rescans everything only
+// when a y extreme has expired from the front.
+// prepareView() narrows the samples to the visible x-range plus one neighbour on each
+// side. When that is more than four points per pixel column, it swaps in the column's
+// first, min, max and last points instead.
+class LoggerSeriesData : public QwtSeriesData<QPointF> {
+public:
+    LoggerSeriesData(const ReadingSeries &series, std::shared_mutex &mutex);
+
+    size_t size() const override;
+    QPointF sample(size_t i) const override;
+    QRectF boundingRect() const override;
+
+    std::shared_lock<std::shared_mutex> lock() const;
+    size_t prepareView(double from, double to, int columns) const;
+    void update();
+
+private:
+    const ReadingSeries &series_;
+    std::shared_mutex &mutex_;
+    mutable size_t viewBegin_;
+    mutable size_t viewSize_;
+    mutable size_t visibleCount_;
+    mutable bool decimated_;
+    mutable QVector<QPointF> decimatedPoints_;
+    mutable size_t viewKey_[6];
+    bool hasBounds_;
+    time_t firstTime_;
+    time_t lastTime_;
+    size_t lastTimeCount_;
+    time_t minTime_;
+    time_t maxTime_;
+    double minY_;
+    double maxY_;
+};
+
+class SeriesCurve : public QwtPlotCurve {
+public:
+    explicit SeriesCurve(LoggerSeriesData *data);
 
+    void drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap, const QRectF &canvasRect, int from,
+                    int to) const override;
+
+private:
+    LoggerSeriesData *seriesData_;
+};
+
+// Draws the live series and, with detail loading enabled, rollups for the part of the
+// visible range older than it. Every scale change picks the finest rollup level that
+// still has data there and fits about two buckets per pixel column, and requests the
+// missing fixed-size tiles of that level through detailRequested().
 class Plot : public QwtPlot {
     Q_OBJECT
 public:
-    explicit Plot(QWidget *parent = nullptr);
+    Plot(const ReadingSeries &series, std::shared_mutex &mutex, QWidget *parent = nullptr);
+
+    void refresh();
 
-    void updatePlot(const QVector<QPair<qint64, double>> &data);
+signals:
+    void detailRequested(int level, qint64 from, qint64 to);
+
+public slots:
+    void enableDetailLoading(qint64 minuteRetention, qint64 hourRetention);
+    void addDetailTile(int level, qint64 from, const QVector<QPointF> &points);
+
+private slots:
+    void updateDetail();
 
 private:
-    QwtPlotCurve *curve_;
+    struct DetailTile {
+        QVector<QPointF> points;
+        bool complete;
+        quint64 lastUsed;
+    };
+    typedef QPair<int, qint64> TileKey;
+
+    bool updateYRange(double minY, double maxY);
+    void showDetail(bool requestTiles);
+    void evictTiles();
+
+    bool detailEnabled_;
+    time_t minuteRetention_;
+    time_t hourRetention_;
+    SeriesCurve *curve_;
+    LoggerSeriesData *data_;
+    QwtPlotCurve *detailCurve_;
+    QwtPlotZoomer *zoomer_;
+    bool hasYRange_;
+    double yLower_;
+    double yUpper_;
+    QMap<TileKey, DetailTile> tiles_;
+    QSet<TileKey> pendingTiles_;
+    quint64 tileUseCounter_;
 };
\ No newline at end of file
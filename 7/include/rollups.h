@@ -0,0 +1,81 @@
+#pragma once
+
+#include "snapshot.h"
+#include "sqlite3.h"
+#include "tdigest.h"
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <vector>
+
+enum class RollupLevel {
+    Minute,
+    Hour,
+    Day
+};
+
+struct RollupBucket {
+    time_t start;
+    long long count;
+    double sum;
+    double min;
+    double max;
+    double sumSquares;
+    TDigest sketch;
+
+    void add(double value);
+    void merge(const RollupBucket &other);
+    double mean() const;
+    double stddev() const;
+};
+
+RollupBucket emptyRollupBucket(time_t start);
+time_t rollupLevelSeconds(RollupLevel level);
+
+// Count/sum/min/max/sum-of-squares per sensor at 1 min, 1 h and 1 day. Minutes are
+// accumulated in memory and merged into rollup_1m when they close; each write then
+// recomputes the enclosing hour from rollup_1m and the day from rollup_1h.
+// Hours and days also carry a t-digest: the closed minute's sketch is merged into the
+// stored hour sketch, and the day sketch is re-merged from its hours.
+class Rollups {
+public:
+    Rollups();
+    ~Rollups();
+
+    void open(sqlite3 *db);
+    void close();
+    bool addSketchColumns();
+
+    void add(int sensorId, time_t time, double value);
+    void rebuild(int sensorId, const ReadingSeries &series);
+    void backfillSketches(int sensorId, const ReadingSeries &series);
+    void flushClosed(time_t now);
+    void flushAll();
+    void expire(time_t minuteCutoff, time_t hourCutoff, time_t dayCutoff);
+
+    std::vector<RollupBucket> query(RollupLevel level, int sensorId, time_t from, time_t to);
+    std::vector<RollupBucket> aggregate(int sensorId, time_t from, time_t to, time_t step);
+    TDigest sketch(int sensorId, time_t from, time_t to);
+
+private:
+    bool exec(const char *sql);
+    bool hasColumn(const char *table, const char *column);
+    bool prepareStatements();
+    void finalizeStatements();
+    bool writeMinute(int sensorId, const RollupBucket &bucket);
+    bool refreshParent(sqlite3_stmt *stmt, int sensorId, time_t start, time_t seconds);
+    bool mergeSketches(sqlite3_stmt *select, sqlite3_stmt *update, int sensorId, time_t start, time_t seconds, const TDigest *extra);
+    void readSketches(const char *table, int sensorId, time_t from, time_t to, TDigest &sketch);
+    void flushBuckets(bool closedOnly, time_t now);
+
+    sqlite3 *db_;
+    sqlite3_stmt *mergeMinuteStmt_;
+    sqlite3_stmt *refreshHourStmt_;
+    sqlite3_stmt *refreshDayStmt_;
+    sqlite3_stmt *selectHourSketchStmt_;
+    sqlite3_stmt *updateHourSketchStmt_;
+    sqlite3_stmt *selectDaySketchesStmt_;
+    sqlite3_stmt *updateDaySketchStmt_;
+    std::map<int, RollupBucket> open_;
+    std::mutex mutex_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "sample.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+struct SensorProfile {
+    double baseTemperature;
+    double diurnalAmplitude;
+    double driftPerDay;
+    double noiseStdDev;
+    double randomWalkStdDev;
+    double spikeProbability;
+    double spikeMagnitude;
+};
+
+SensorProfile defaultSensorProfile();
+
+class FastRandom {
+public:
+    explicit FastRandom(std::uint64_t seed);
+
+    std::uint64_t next();
+    double uniform();
+    double gaussian();
+
+private:
+    std::uint64_t state_[2];
+    double spare_;
+    bool hasSpare_;
+};
+
+class Simulator {
+public:
+    explicit Simulator(std::uint64_t seed);
+
+    int addSensor(const SensorProfile &profile, time_t startTime);
+    size_t getSensorCount() const;
+
+    void generate(time_t start, time_t period, size_t steps, Sample *samples);
+    void generate(time_t start, time_t period, size_t steps, std::vector<Sample> &samples);
+    Sample generateOne(int sensorId, time_t timestamp);
+
+private:
+    struct VirtualSensor {
+        SensorProfile profile;
+        time_t startTime;
+        double walk;
+    };
+
+    double nextValue(VirtualSensor &sensor, time_t timestamp);
+
+    FastRandom random_;
+    std::vector<VirtualSensor> sensors_;
+};
@@ -0,0 +1,9 @@
+# Sources shared with temperature_monitor.pro.
+include(common.pri)
+
+SOURCES += \
+    src/plot_bench.cpp
+
+TARGET = plot_bench
+CONFIG += console
+CONFIG -= app_bundle
@@ -0,0 +1,61 @@
+#include "../include/acquisition_thread.h"
+#include <QDebug>
+#include <chrono>
+
+static const std::chrono::milliseconds displayInterval(100);
+static const int reopenDelayMs = 5000;
+
+AcquisitionThread::AcquisitionThread(const std::string &portName, QObject *parent)
+    : QThread(parent), serialPort_(portName), sensor_() {
+}
+
+AcquisitionThread::~AcquisitionThread() {
+    requestInterruption();
+    wait();
+}
+
+void AcquisitionThread::run() {
+    std::vector<Sample> samples;
+    QVector<Sample> batch;
+    auto lastEmit = std::chrono::steady_clock::now();
+
+    while (!isInterruptionRequested()) {
+        samples.clear();
+#ifdef USE_SIMULATION
+        msleep(static_cast<unsigned long>(displayInterval.count()));
+        samples.push_back(sensor_.getSample());
+#else
+        if (!serialPort_.isOpen()) {
+            if (!serialPort_.openPort()) {
+                qDebug() << "Failed to open port, retrying in 5 seconds...";
+                waitInterruptible(reopenDelayMs);
+                continue;
+            }
+            qDebug() << "Port successfully opened";
+        }
+
+        parser_.feed(serialPort_.readData(), samples);
+#endif
+        for (const auto &sample : samples) {
+            batch.append(sample);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!batch.isEmpty() && now - lastEmit >= displayInterval) {
+            emit samplesAcquired(batch);
+            emit latestValue(batch.last().value);
+            batch.clear();
+            lastEmit = now;
+        }
+    }
+
+    if (!batch.isEmpty()) {
+        emit samplesAcquired(batch);
+    }
+}
+
+void AcquisitionThread::waitInterruptible(int milliseconds) {
+    for (int waited = 0; waited < milliseconds && !isInterruptionRequested(); waited += 100) {
+        msleep(100);
+    }
+}
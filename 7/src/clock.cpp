@@ -0,0 +1,34 @@
+#include "../include/clock.h"
+
+time_t SystemClock::now() {
+    return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+}
+
+ScaledClock::ScaledClock(int scale) : startTime_(std::chrono::system_clock::now()), scale_(scale) {
+}
+
+time_t ScaledClock::now() {
+    auto duration = std::chrono::system_clock::now() - startTime_;
+    double timeDiff = std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+    return static_cast<time_t>(std::chrono::system_clock::to_time_t(startTime_) + timeDiff * scale_);
+}
+
+VirtualClock::VirtualClock(time_t startTime, time_t period) : currentTime_(startTime), period_(period) {
+}
+
+time_t VirtualClock::now() {
+    return currentTime_;
+}
+
+time_t VirtualClock::advance() {
+    currentTime_ += period_;
+    return currentTime_;
+}
+
+void VirtualClock::set(time_t time) {
+    currentTime_ = time;
+}
+
+time_t VirtualClock::getPeriod() const {
+    return period_;
+}
@@ -0,0 +1,315 @@
+#include "../include/compressed_block.h"
+#include <cstring>
+
+static void putUint32(char *out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static void putInt64(char *out, std::int64_t value) {
+    std::uint64_t bits = static_cast<std::uint64_t>(value);
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<char>(bits >> (8 * i));
+    }
+}
+
+static std::uint64_t getUint(const unsigned char *in, int bytes) {
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+static std::uint64_t doubleBits(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double bitsDouble(std::uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static int leadingZeros(std::uint64_t value) {
+    return __builtin_clzll(value);
+}
+
+static int trailingZeros(std::uint64_t value) {
+    return __builtin_ctzll(value);
+}
+
+static std::int64_t signExtend(std::uint64_t bits, int count) {
+    std::uint64_t sign = std::uint64_t(1) << (count - 1);
+    return static_cast<std::int64_t>((bits ^ sign) - sign);
+}
+
+bool readCompressedBlockInfo(const char *data, size_t size, CompressedBlockInfo &info) {
+    if (size < compressedBlockHeaderSize) {
+        return false;
+    }
+
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(data);
+    info.count = static_cast<std::uint32_t>(getUint(in, 4));
+    info.firstTime = static_cast<time_t>(static_cast<std::int64_t>(getUint(in + 4, 8)));
+    info.lastTime = static_cast<time_t>(static_cast<std::int64_t>(getUint(in + 12, 8)));
+    return info.count > 0 && info.firstTime <= info.lastTime;
+}
+
+BlockEncoder::BlockEncoder() {
+    clear();
+}
+
+void BlockEncoder::clear() {
+    stream_.clear();
+    freeBits_ = 0;
+    count_ = 0;
+    firstTime_ = 0;
+    lastTime_ = 0;
+    lastDelta_ = 0;
+    lastValue_ = 0;
+    lastLeading_ = -1;
+    lastTrailing_ = 0;
+}
+
+bool BlockEncoder::append(time_t time, double value) {
+    std::uint64_t bits = doubleBits(value);
+
+    if (count_ == 0) {
+        firstTime_ = lastTime_ = time;
+        writeBits(bits, 64);
+        lastValue_ = bits;
+        count_ = 1;
+        return true;
+    }
+    if (time < lastTime_) {
+        return false;
+    }
+
+    std::int64_t delta = static_cast<std::int64_t>(time - lastTime_);
+    std::int64_t deltaOfDelta = delta - lastDelta_;
+    if (deltaOfDelta == 0) {
+        writeBits(0, 1);
+    } else if (deltaOfDelta >= -64 && deltaOfDelta <= 63) {
+        writeBits(0x2, 2);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 7);
+    } else if (deltaOfDelta >= -256 && deltaOfDelta <= 255) {
+        writeBits(0x6, 3);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 9);
+    } else if (deltaOfDelta >= -2048 && deltaOfDelta <= 2047) {
+        writeBits(0xE, 4);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 12);
+    } else {
+        writeBits(0xF, 4);
+        writeBits(static_cast<std::uint64_t>(deltaOfDelta), 64);
+    }
+    lastDelta_ = delta;
+    lastTime_ = time;
+
+    std::uint64_t xorValue = bits ^ lastValue_;
+    if (xorValue == 0) {
+        writeBits(0, 1);
+    } else {
+        int leading = leadingZeros(xorValue);
+        int trailing = trailingZeros(xorValue);
+        if (leading > 31) {
+            leading = 31;
+        }
+
+        if (lastLeading_ != -1 && leading >= lastLeading_ && trailing >= lastTrailing_) {
+            writeBits(0x2, 2);
+            writeBits(xorValue >> lastTrailing_, 64 - lastLeading_ - lastTrailing_);
+        } else {
+            int meaningful = 64 - leading - trailing;
+            writeBits(0x3, 2);
+            writeBits(static_cast<std::uint64_t>(leading), 5);
+            writeBits(static_cast<std::uint64_t>(meaningful & 63), 6);
+            writeBits(xorValue >> trailing, meaningful);
+            lastLeading_ = leading;
+            lastTrailing_ = trailing;
+        }
+    }
+    lastValue_ = bits;
+
+    ++count_;
+    return true;
+}
+
+size_t BlockEncoder::size() const {
+    return count_;
+}
+
+time_t BlockEncoder::firstTime() const {
+    return firstTime_;
+}
+
+time_t BlockEncoder::lastTime() const {
+    return lastTime_;
+}
+
+size_t BlockEncoder::encodedSize() const {
+    return compressedBlockHeaderSize + stream_.size();
+}
+
+void BlockEncoder::encode(std::string &out) const {
+    char header[compressedBlockHeaderSize];
+    putUint32(header, count_);
+    putInt64(header + 4, static_cast<std::int64_t>(firstTime_));
+    putInt64(header + 12, static_cast<std::int64_t>(lastTime_));
+    out.append(header, sizeof(header));
+    out.append(stream_);
+}
+
+void BlockEncoder::writeBits(std::uint64_t bits, int count) {
+    if (count < 64) {
+        bits &= (std::uint64_t(1) << count) - 1;
+    }
+
+    while (count > 0) {
+        if (freeBits_ == 0) {
+            stream_.push_back('\0');
+            freeBits_ = 8;
+        }
+
+        int take = count < freeBits_ ? count : freeBits_;
+        unsigned char chunk = static_cast<unsigned char>((bits >> (count - take)) & ((1u << take) - 1));
+        stream_[stream_.size() - 1] = static_cast<char>(static_cast<unsigned char>(stream_[stream_.size() - 1]) |
+                                                        (chunk << (freeBits_ - take)));
+        freeBits_ -= take;
+        count -= take;
+    }
+}
+
+BlockDecoder::BlockDecoder(const char *data, size_t size)
+    : data_(nullptr), end_(nullptr), buffer_(0), available_(0), valid_(false), decoded_(0), time_(0), delta_(0), value_(0),
+      leading_(0), trailing_(0) {
+    info_.count = 0;
+    info_.firstTime = 0;
+    info_.lastTime = 0;
+    if (!readCompressedBlockInfo(data, size, info_)) {
+        return;
+    }
+
+    data_ = reinterpret_cast<const unsigned char *>(data) + compressedBlockHeaderSize;
+    end_ = reinterpret_cast<const unsigned char *>(data) + size;
+    valid_ = true;
+}
+
+bool BlockDecoder::isValid() const {
+    return valid_;
+}
+
+const CompressedBlockInfo &BlockDecoder::info() const {
+    return info_;
+}
+
+bool BlockDecoder::next(time_t &time, double &value) {
+    if (!valid_ || decoded_ == info_.count) {
+        return false;
+    }
+
+    std::uint64_t bits;
+    if (decoded_ == 0) {
+        if (!readBits(64, bits)) {
+            valid_ = false;
+            return false;
+        }
+        time_ = info_.firstTime;
+        value_ = bits;
+        ++decoded_;
+        time = time_;
+        value = bitsDouble(value_);
+        return true;
+    }
+
+    int prefix = 0;
+    while (prefix < 4) {
+        if (!readBits(1, bits)) {
+            valid_ = false;
+            return false;
+        }
+        if (bits == 0) {
+            break;
+        }
+        ++prefix;
+    }
+
+    static const int deltaWidths[] = {0, 7, 9, 12, 64};
+    std::int64_t deltaOfDelta = 0;
+    if (prefix > 0) {
+        if (!readBits(deltaWidths[prefix], bits)) {
+            valid_ = false;
+            return false;
+        }
+        deltaOfDelta = prefix == 4 ? static_cast<std::int64_t>(bits) : signExtend(bits, deltaWidths[prefix]);
+    }
+    delta_ += deltaOfDelta;
+    time_ += static_cast<time_t>(delta_);
+
+    if (!readBits(1, bits)) {
+        valid_ = false;
+        return false;
+    }
+    if (bits == 1) {
+        if (!readBits(1, bits)) {
+            valid_ = false;
+            return false;
+        }
+        if (bits == 1) {
+            std::uint64_t leading;
+            std::uint64_t meaningful;
+            if (!readBits(5, leading) || !readBits(6, meaningful)) {
+                valid_ = false;
+                return false;
+            }
+            if (meaningful == 0) {
+                meaningful = 64;
+            }
+            leading_ = static_cast<int>(leading);
+            trailing_ = 64 - leading_ - static_cast<int>(meaningful);
+            if (trailing_ < 0) {
+                valid_ = false;
+                return false;
+            }
+        }
+
+        int width = 64 - leading_ - trailing_;
+        if (!readBits(width, bits)) {
+            valid_ = false;
+            return false;
+        }
+        value_ ^= bits << trailing_;
+    }
+
+    ++decoded_;
+    time = time_;
+    value = bitsDouble(value_);
+    return true;
+}
+
+bool BlockDecoder::readBits(int count, std::uint64_t &bits) {
+    if (count > 32) {
+        std::uint64_t high;
+        std::uint64_t low;
+        if (!readBits(count - 32, high) || !readBits(32, low)) {
+            return false;
+        }
+        bits = (high << 32) | low;
+        return true;
+    }
+
+    while (available_ < count) {
+        if (data_ == end_) {
+            return false;
+        }
+        buffer_ = (buffer_ << 8) | *data_++;
+        available_ += 8;
+    }
+
+    available_ -= count;
+    bits = (buffer_ >> available_) & ((std::uint64_t(1) << count) - 1);
+    return true;
+}
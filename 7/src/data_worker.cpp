@@ -0,0 +1,30 @@
+#include "../include/data_worker.h"
+
+DataWorker::DataWorker(Logger &logger, QObject *parent) : QObject(parent), logger_(logger) {
+    qRegisterMetaType<QVector<Sample>>("QVector<Sample>");
+    qRegisterMetaType<QVector<QPointF>>("QVector<QPointF>");
+}
+
+void DataWorker::logSamples(const QVector<Sample> &samples) {
+    for (const auto &sample : samples) {
+        logger_.logSample(sample);
+    }
+}
+
+void DataWorker::refresh() {
+    logger_.updateLogs();
+    emit seriesUpdated();
+}
+
+void DataWorker::loadDetail(int level, qint64 from, qint64 to) {
+    RollupLevel rollupLevel = static_cast<RollupLevel>(level);
+    double halfBucket = rollupLevelSeconds(rollupLevel) / 2.0;
+    std::vector<RollupBucket> buckets = logger_.getRollups(rollupLevel, static_cast<time_t>(from), static_cast<time_t>(to));
+
+    QVector<QPointF> points;
+    points.reserve(static_cast<int>(buckets.size()));
+    for (const auto &bucket : buckets) {
+        points.append(QPointF(static_cast<double>(bucket.start) + halfBucket, bucket.mean()));
+    }
+    emit detailLoaded(level, from, points);
+}
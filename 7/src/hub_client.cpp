@@ -0,0 +1,155 @@
+#include "../include/hub_client.h"
+#include <QDebug>
+#include <QList>
+#include <QTimer>
+#include <mutex>
+
+static const int reconnectDelayMs = 5000;
+
+HubClient::HubClient(const QString &socketPath, QObject *parent)
+    : QObject(parent), socketPath_(socketPath), socket_(this), live_(false), reconnectPending_(false) {
+    qRegisterMetaType<QVector<QPointF>>("QVector<QPointF>");
+    connect(&socket_, &QLocalSocket::readyRead, this, &HubClient::readLines);
+    connect(&socket_, &QLocalSocket::disconnected, this, &HubClient::scheduleReconnect);
+    connect(&socket_, &QLocalSocket::errorOccurred, this, &HubClient::scheduleReconnect);
+}
+
+void HubClient::start() {
+    connectToHub();
+}
+
+std::shared_mutex &HubClient::getSeriesMutex() const {
+    return seriesMutex_;
+}
+
+const ReadingSeries &HubClient::getReadingSeries() const {
+    return readings_;
+}
+
+const ReadingSeries &HubClient::getHourlyAverageSeries() const {
+    return hourlyAverages_;
+}
+
+const ReadingSeries &HubClient::getDailyAverageSeries() const {
+    return dailyAverages_;
+}
+
+void HubClient::loadDetail(int level, qint64 from, qint64 to) {
+    if (socket_.state() != QLocalSocket::ConnectedState) {
+        return;
+    }
+    socket_.write(QString("rollups %1 %2 %3\n").arg(level).arg(from).arg(to).toLatin1());
+}
+
+void HubClient::connectToHub() {
+    live_ = false;
+    reconnectPending_ = false;
+    socket_.connectToServer(socketPath_, QIODevice::ReadWrite);
+}
+
+void HubClient::scheduleReconnect() {
+    // Both errorOccurred and disconnected may fire for one failure; one retry is enough.
+    if (reconnectPending_) {
+        return;
+    }
+    reconnectPending_ = true;
+    live_ = false;
+    qDebug() << "Hub unavailable, retrying in 5 seconds..." << socket_.errorString();
+    socket_.abort();
+    QTimer::singleShot(reconnectDelayMs, this, &HubClient::connectToHub);
+}
+
+void HubClient::readLines() {
+    bool changed = false;
+    while (socket_.canReadLine()) {
+        QByteArray line = socket_.readLine();
+        line.chop(1);
+        changed = handleLine(line) || changed;
+    }
+
+    // The snapshot is announced once, when it is complete.
+    if (changed && live_) {
+        emit seriesUpdated();
+        std::shared_lock<std::shared_mutex> lock(seriesMutex_);
+        if (!readings_.empty()) {
+            double value = readings_.back().second;
+            lock.unlock();
+            emit latestValue(value);
+        }
+    }
+}
+
+bool HubClient::handleLine(const QByteArray &line) {
+    QList<QByteArray> fields = line.split(' ');
+    const QByteArray &type = fields[0];
+
+    if (type == "r" || type == "h" || type == "d") {
+        ReadingSeries *series = getSeries(type);
+        if (fields.size() < 3) {
+            return false;
+        }
+        std::unique_lock<std::shared_mutex> lock(seriesMutex_);
+        series->push_back(std::make_pair(static_cast<time_t>(fields[1].toLongLong()), fields[2].toDouble()));
+        return true;
+    }
+
+    if (type == "x" && fields.size() >= 3) {
+        ReadingSeries *series = getSeries(fields[1]);
+        if (!series) {
+            return false;
+        }
+        time_t before = static_cast<time_t>(fields[2].toLongLong());
+        std::unique_lock<std::shared_mutex> lock(seriesMutex_);
+        while (!series->empty() && series->front().first < before) {
+            series->pop_front();
+        }
+        return true;
+    }
+
+    if (type == "tile" && fields.size() >= 3) {
+        QVector<QPointF> points;
+        points.reserve(fields.size() - 3);
+        for (int i = 3; i < fields.size(); ++i) {
+            int comma = fields[i].indexOf(',');
+            if (comma > 0) {
+                points.append(QPointF(fields[i].left(comma).toDouble(), fields[i].mid(comma + 1).toDouble()));
+            }
+        }
+        emit detailLoaded(fields[1].toInt(), fields[2].toLongLong(), points);
+        return false;
+    }
+
+    if (type == "hello" && fields.size() >= 4) {
+        {
+            std::unique_lock<std::shared_mutex> lock(seriesMutex_);
+            readings_.clear();
+            hourlyAverages_.clear();
+            dailyAverages_.clear();
+        }
+        emit connected(fields[2].toLongLong(), fields[3].toLongLong());
+        return false;
+    }
+
+    if (type == "live") {
+        live_ = true;
+        return true;
+    }
+
+    if (type == "error") {
+        qDebug() << "Hub rejected a request:" << line;
+    }
+    return false;
+}
+
+ReadingSeries *HubClient::getSeries(const QByteArray &code) {
+    if (code == "r") {
+        return &readings_;
+    }
+    if (code == "h") {
+        return &hourlyAverages_;
+    }
+    if (code == "d") {
+        return &dailyAverages_;
+    }
+    return nullptr;
+}
@@ -1,8 +1,17 @@
 #include "../include/mainwindow.h"
 #include <QApplication>
+#include <cstring>
 #include <iostream>
 
 int main(int argc, char *argv[]) {
+    // Follow the ingest of a running HTTP server (5/) instead of reading the sensor here.
+    if (argc > 2 && std::strcmp(argv[1], "--hub") == 0) {
+        QApplication a(argc, argv);
+        HubClient hub(QString::fromLocal8Bit(argv[2]));
+        MainWindow w(hub);
+        w.show();
+        return a.exec();
+    }
 
     int scale = 1;
     if (argc > 1) {
@@ -4,8 +4,53 @@
 #include <QMessageBox>
 #include <QKeyEvent>
 
+static const int hubRefreshIntervalMs = 500;
+
 MainWindow::MainWindow(Logger &logger, QWidget *parent)
-    : QMainWindow(parent), logger_(logger), serialPort_("COM3"), sensor_() {
+    : QMainWindow(parent), worker_(new DataWorker(logger)), refreshPending_(false), updateTimer_(nullptr),
+      acquisition_(new AcquisitionThread("COM3")) {
+    createPlots(logger.getReadingSeries(), logger.getHourlyAverageSeries(), logger.getDailyAverageSeries(), logger.getSeriesMutex());
+
+    worker_->moveToThread(&workerThread_);
+    connect(&workerThread_, &QThread::finished, worker_, &QObject::deleteLater);
+    connect(acquisition_, &AcquisitionThread::samplesAcquired, worker_, &DataWorker::logSamples);
+    connect(acquisition_, &AcquisitionThread::latestValue, this, &MainWindow::showLatestValue);
+    connect(this, &MainWindow::refreshRequested, worker_, &DataWorker::refresh);
+    connect(worker_, &DataWorker::seriesUpdated, this, &MainWindow::refreshPlots);
+    connect(plotAll_, &Plot::detailRequested, worker_, &DataWorker::loadDetail);
+    connect(worker_, &DataWorker::detailLoaded, plotAll_, &Plot::addDetailTile);
+    plotAll_->enableDetailLoading(logger.getRollupRetention(RollupLevel::Minute), logger.getRollupRetention(RollupLevel::Hour));
+    workerThread_.start();
+    refreshPlots();
+    acquisition_->start();
+
+    updateTimer_ = new QTimer(this);
+    connect(updateTimer_, &QTimer::timeout, this, &MainWindow::updateReadings);
+    updateTimer_->start(5000);
+
+    installEventFilter(this);
+    showFullScreen();
+}
+
+// Read-only view of the ingest process behind the hub: no acquisition or worker thread,
+// and refreshes follow its pushes instead of a timer.
+MainWindow::MainWindow(HubClient &hub, QWidget *parent)
+    : QMainWindow(parent), worker_(nullptr), refreshPending_(false), updateTimer_(nullptr), acquisition_(nullptr) {
+    createPlots(hub.getReadingSeries(), hub.getHourlyAverageSeries(), hub.getDailyAverageSeries(), hub.getSeriesMutex());
+
+    connect(&hub, &HubClient::latestValue, this, &MainWindow::showLatestValue);
+    connect(&hub, &HubClient::seriesUpdated, this, &MainWindow::scheduleRefresh);
+    connect(&hub, &HubClient::connected, plotAll_, &Plot::enableDetailLoading);
+    connect(plotAll_, &Plot::detailRequested, &hub, &HubClient::loadDetail);
+    connect(&hub, &HubClient::detailLoaded, plotAll_, &Plot::addDetailTile);
+    hub.start();
+
+    installEventFilter(this);
+    showFullScreen();
+}
+
+void MainWindow::createPlots(const ReadingSeries &readings, const ReadingSeries &hourlyAverages, const ReadingSeries &dailyAverages,
+                             std::shared_mutex &mutex) {
     setWindowTitle("Temperature Monitor");
 
     QWidget *centralWidget = new QWidget(this);
@@ -14,97 +59,64 @@ MainWindow::MainWindow(Logger &logger, QWidget *parent)
     currentTempLabel_ = new QLabel("Current Temperature: N/A", this);
     mainLayout->addWidget(currentTempLabel_);
 
-    plotAll_ = new Plot(this);
+    plotAll_ = new Plot(readings, mutex, this);
     plotAll_->setTitle("All Readings");
     mainLayout->addWidget(plotAll_);
 
-    plotHourly_ = new Plot(this);
+    plotHourly_ = new Plot(hourlyAverages, mutex, this);
     plotHourly_->setTitle("Hourly Average");
     mainLayout->addWidget(plotHourly_);
 
-    plotDaily_ = new Plot(this);
+    plotDaily_ = new Plot(dailyAverages, mutex, this);
     plotDaily_->setTitle("Daily Average");
     mainLayout->addWidget(plotDaily_);
 
     setCentralWidget(centralWidget);
-
-    timer_ = new QTimer(this);
-    connect(timer_, &QTimer::timeout, this, &MainWindow::updateDisplay);
-    timer_->start(100);
-
-    updateTimer_ = new QTimer(this);
-    connect(updateTimer_, &QTimer::timeout, this, &MainWindow::updateReadings);
-    updateTimer_->start(5000);
-
-    installEventFilter(this);
-    showFullScreen();
 }
 
 MainWindow::~MainWindow() {
-    if (timer_) {
-        timer_->stop();
-        delete timer_;
-        timer_ = nullptr;
+    if (acquisition_) {
+        acquisition_->requestInterruption();
+        acquisition_->wait();
+        delete acquisition_;
+        acquisition_ = nullptr;
     }
     if (updateTimer_) {
         updateTimer_->stop();
         delete updateTimer_;
         updateTimer_ = nullptr;
     }
+    workerThread_.quit();
+    workerThread_.wait();
 }
 
-void MainWindow::updateDisplay() {
-    std::string temperature;
-#ifdef USE_SIMULATION
-    temperature = sensor_.getTemperature();
-#else
-    if (!serialPort_.isOpen()) {
-        if (!serialPort_.openPort()) {
-            qDebug() << "Failed to open port, retrying in 5 seconds...";
-            return;
-        } else {
-            qDebug() << "Port successfully opened";
-        }
-    }
-
-    temperature = serialPort_.readData();
-
-    if (temperature.empty()) {
-        return;
-    }
-#endif
-    currentTempLabel_->setText(QString("Current Temperature: %1 °C").arg(QString::fromStdString(temperature)));
-    logger_.logTemperature(temperature);
+void MainWindow::showLatestValue(double value) {
+    currentTempLabel_->setText(QString("Current Temperature: %1 °C").arg(value, 0, 'f', 1));
 }
 
 void MainWindow::updateReadings() {
-
-    logger_.updateLogs();
-
-    std::vector<std::pair<time_t, double>> allReadings = logger_.getAllReadings();
-    std::vector<std::pair<time_t, double>> hourlyReadings = logger_.getHourlyAverageReadings();
-    std::vector<std::pair<time_t, double>> dailyReadings = logger_.getDailyAverageReadings();
-        QVector<QPair<qint64, double>> allData;
-    for (const auto &reading : allReadings) {
-        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(reading.first);
-        allData.append(QPair<qint64, double>(dateTime.toMSecsSinceEpoch(), reading.second));
-    }
-
-    QVector<QPair<qint64, double>> hourlyData;
-    for (const auto &reading : hourlyReadings) {
-        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(reading.first);
-       hourlyData.append(QPair<qint64, double>(dateTime.toMSecsSinceEpoch(), reading.second));
+    // Skip a tick rather than queue refreshes behind a slow one.
+    if (refreshPending_) {
+        return;
     }
+    refreshPending_ = true;
+    emit refreshRequested();
+}
 
-    QVector<QPair<qint64, double>> dailyData;
-    for (const auto &reading : dailyReadings) {
-        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(reading.first);
-        dailyData.append(QPair<qint64, double>(dateTime.toMSecsSinceEpoch(), reading.second));
+// Pushes arrive with every sample batch; one refresh covers all of them in an interval.
+void MainWindow::scheduleRefresh() {
+    if (refreshPending_) {
+        return;
     }
+    refreshPending_ = true;
+    QTimer::singleShot(hubRefreshIntervalMs, this, &MainWindow::refreshPlots);
+}
 
-    plotAll_->updatePlot(allData);
-    plotHourly_->updatePlot(hourlyData);
-    plotDaily_->updatePlot(dailyData);
+void MainWindow::refreshPlots() {
+    refreshPending_ = false;
+    plotAll_->refresh();
+    plotHourly_->refresh();
+    plotDaily_->refresh();
 }
 
 
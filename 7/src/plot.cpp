@@ -2,27 +2,259 @@
 #include <QDateTime>
 #include <QDebug>
 #include <qwt_plot_grid.h>
+#include <qwt_plot_magnifier.h>
+#include <qwt_plot_panner.h>
 #include <qwt_plot_zoomer.h>
+#include <qwt_scale_widget.h>
 #include <qwt_date.h>
 #include <qwt_scale_draw.h>
 #include <qwt_text.h>
+#include <QHash>
+#include <QPainter>
 #include <QTimeZone>
+#include <algorithm>
+#include <cmath>
 
+// Qwt drops its own label cache on every scale change, which the live plot has on every
+// refresh. This one keeps labels by tick value across changes and only drops them when
+// the tick step calls for another format.
 class CustomScaleDraw : public QwtScaleDraw
 {
 public:
-    CustomScaleDraw(const QTimeZone& timeZone) : timeZone_(timeZone) {}
+    CustomScaleDraw(const QTimeZone& timeZone) : timeZone_(timeZone), lowerBound_(0.0), upperBound_(0.0) {}
     
     QwtText label(double v) const override {
-        QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(v * 1000), timeZone_);
-        return dateTime.toString("yyyy-MM-dd hh:mm:ss");
+        updateFormat();
+        qint64 seconds = static_cast<qint64>(std::floor(v));
+        auto it = labels_.constFind(seconds);
+        if (it != labels_.constEnd()) {
+            return *it;
+        }
+        if (labels_.size() >= maxCachedLabels) {
+            labels_.clear();
+        }
+        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(seconds, timeZone_);
+        return *labels_.insert(seconds, QwtText(dateTime.toString(format_)));
     }
 private:
+    static const int maxCachedLabels = 1024;
+
+    void updateFormat() const {
+        const QwtScaleDiv &div = scaleDiv();
+        if (div.lowerBound() == lowerBound_ && div.upperBound() == upperBound_ && !format_.isEmpty()) {
+            return;
+        }
+        lowerBound_ = div.lowerBound();
+        upperBound_ = div.upperBound();
+
+        QList<double> ticks = div.ticks(QwtScaleDiv::MajorTick);
+        double step = ticks.size() > 1 ? std::fabs(ticks[1] - ticks[0]) : std::fabs(div.range());
+        QString format;
+        if (step >= 86400.0) {
+            format = "yyyy-MM-dd";
+        } else if (step >= 60.0) {
+            format = "MM-dd hh:mm";
+        } else {
+            format = "hh:mm:ss";
+        }
+        if (format != format_) {
+            format_ = format;
+            labels_.clear();
+        }
+    }
+
     QTimeZone timeZone_;
+    mutable double lowerBound_;
+    mutable double upperBound_;
+    mutable QString format_;
+    mutable QHash<qint64, QwtText> labels_;
 };
 
 
-Plot::Plot(QWidget *parent) : QwtPlot(parent) {
+static const int pointsPerColumn = 4;
+static const int symbolSpacingPixels = 6;
+static const int bucketsPerTile = 1024;
+static const int maxDetailTiles = 64;
+static const double yMarginFraction = 0.1;
+static const double yMinimumMargin = 0.5;
+static const double yShrinkFraction = 0.5;
+
+static bool readingBefore(const std::pair<time_t, double> &reading, double x) {
+    return static_cast<double>(reading.first) < x;
+}
+
+static bool readingAfter(double x, const std::pair<time_t, double> &reading) {
+    return x < static_cast<double>(reading.first);
+}
+
+LoggerSeriesData::LoggerSeriesData(const ReadingSeries &series, std::shared_mutex &mutex)
+    : series_(series), mutex_(mutex), viewBegin_(0), viewSize_(0), visibleCount_(0), decimated_(false), viewKey_(), hasBounds_(false),
+      firstTime_(0), lastTime_(0), lastTimeCount_(0), minTime_(0), maxTime_(0), minY_(0.0), maxY_(0.0) {
+}
+
+size_t LoggerSeriesData::size() const {
+    return decimated_ ? static_cast<size_t>(decimatedPoints_.size()) : viewSize_;
+}
+
+QPointF LoggerSeriesData::sample(size_t i) const {
+    if (decimated_) {
+        return decimatedPoints_[static_cast<int>(i)];
+    }
+    const auto &reading = series_[viewBegin_ + i];
+    return QPointF(static_cast<double>(reading.first), reading.second);
+}
+
+QRectF LoggerSeriesData::boundingRect() const {
+    if (!hasBounds_) {
+        return QRectF(1.0, 1.0, -2.0, -2.0);
+    }
+    return QRectF(static_cast<double>(firstTime_), minY_, static_cast<double>(lastTime_ - firstTime_), maxY_ - minY_);
+}
+
+std::shared_lock<std::shared_mutex> LoggerSeriesData::lock() const {
+    return std::shared_lock<std::shared_mutex>(mutex_);
+}
+
+size_t LoggerSeriesData::prepareView(double from, double to, int columns) const {
+    if (series_.empty() || to <= from || columns <= 0) {
+        viewSize_ = 0;
+        visibleCount_ = 0;
+        decimated_ = false;
+        return 0;
+    }
+
+    // Plain repaints keep the previous view; data, range or width changes rebuild it.
+    // The front time is part of the key because one point can expire while another
+    // arrives in the same second, leaving size and back time unchanged.
+    size_t key[6] = {series_.size(), static_cast<size_t>(series_.front().first), static_cast<size_t>(series_.back().first),
+                     static_cast<size_t>(columns), static_cast<size_t>(static_cast<long long>(from)),
+                     static_cast<size_t>(static_cast<long long>(to))};
+    if (std::equal(key, key + 6, viewKey_)) {
+        return visibleCount_;
+    }
+    std::copy(key, key + 6, viewKey_);
+
+    auto lower = std::lower_bound(series_.begin(), series_.end(), from, readingBefore);
+    auto upper = std::upper_bound(lower, series_.end(), to, readingAfter);
+    size_t visibleBegin = static_cast<size_t>(lower - series_.begin());
+    size_t visibleEnd = static_cast<size_t>(upper - series_.begin());
+    viewBegin_ = visibleBegin > 0 ? visibleBegin - 1 : 0;
+    viewSize_ = std::min(visibleEnd + 1, series_.size()) - viewBegin_;
+    visibleCount_ = visibleEnd - visibleBegin;
+    decimated_ = visibleCount_ > static_cast<size_t>(columns) * pointsPerColumn;
+    if (!decimated_) {
+        return visibleCount_;
+    }
+
+    decimatedPoints_.clear();
+    auto append = [this](const std::pair<time_t, double> &reading) {
+        decimatedPoints_.append(QPointF(static_cast<double>(reading.first), reading.second));
+    };
+    if (viewBegin_ < visibleBegin) {
+        append(series_[viewBegin_]);
+    }
+
+    double scale = columns / (to - from);
+    size_t i = visibleBegin;
+    while (i < visibleEnd) {
+        int column = static_cast<int>((series_[i].first - from) * scale);
+        size_t first = i;
+        size_t minIndex = i;
+        size_t maxIndex = i;
+        for (++i; i < visibleEnd && static_cast<int>((series_[i].first - from) * scale) == column; ++i) {
+            if (series_[i].second < series_[minIndex].second) {
+                minIndex = i;
+            }
+            if (series_[i].second > series_[maxIndex].second) {
+                maxIndex = i;
+            }
+        }
+        size_t last = i - 1;
+
+        size_t picks[4] = {first, std::min(minIndex, maxIndex), std::max(minIndex, maxIndex), last};
+        for (int k = 0; k < 4; ++k) {
+            if (k == 0 || picks[k] != picks[k - 1]) {
+                append(series_[picks[k]]);
+            }
+        }
+    }
+
+    if (visibleEnd < series_.size()) {
+        append(series_[visibleEnd]);
+    }
+    return visibleCount_;
+}
+
+void LoggerSeriesData::update() {
+    if (series_.empty()) {
+        hasBounds_ = false;
+        return;
+    }
+
+    // Several points can share lastTime_, so the ones at lastTime_ already seen are
+    // counted rather than assumed to be all of them.
+    size_t begin = 0;
+    firstTime_ = series_.front().first;
+    if (hasBounds_ && minTime_ >= firstTime_ && maxTime_ >= firstTime_) {
+        begin = series_.size();
+        while (begin > 0 && series_[begin - 1].first > lastTime_) {
+            --begin;
+        }
+        size_t atLastTime = 0;
+        while (begin > atLastTime && series_[begin - atLastTime - 1].first == lastTime_) {
+            ++atLastTime;
+        }
+        begin -= atLastTime - std::min(atLastTime, lastTimeCount_);
+    } else {
+        hasBounds_ = false;
+    }
+
+    for (size_t i = begin; i < series_.size(); ++i) {
+        const auto &reading = series_[i];
+        if (!hasBounds_ || reading.second < minY_) {
+            minY_ = reading.second;
+            minTime_ = reading.first;
+        }
+        if (!hasBounds_ || reading.second > maxY_) {
+            maxY_ = reading.second;
+            maxTime_ = reading.first;
+        }
+        hasBounds_ = true;
+    }
+    lastTime_ = series_.back().first;
+    lastTimeCount_ = 0;
+    for (size_t i = series_.size(); i > 0 && series_[i - 1].first == lastTime_; --i) {
+        ++lastTimeCount_;
+    }
+}
+
+SeriesCurve::SeriesCurve(LoggerSeriesData *data) : seriesData_(data) {
+    setData(data);
+}
+
+void SeriesCurve::drawSeries(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap, const QRectF &canvasRect, int from,
+                             int to) const {
+    auto lock = seriesData_->lock();
+    int columns = static_cast<int>(std::abs(xMap.p2() - xMap.p1()));
+    size_t visible = seriesData_->prepareView(std::min(xMap.s1(), xMap.s2()), std::max(xMap.s1(), xMap.s2()), columns);
+
+    // Symbols closer than their own size only smear the line, so draw them only when sparse.
+    if (visible * symbolSpacingPixels <= static_cast<size_t>(columns)) {
+        QwtPlotCurve::drawSeries(painter, xMap, yMap, canvasRect, from, to);
+        return;
+    }
+    if (dataSize() == 0) {
+        return;
+    }
+    painter->save();
+    painter->setPen(pen());
+    drawCurve(painter, style(), xMap, yMap, canvasRect, 0, static_cast<int>(dataSize()) - 1);
+    painter->restore();
+}
+
+Plot::Plot(const ReadingSeries &series, std::shared_mutex &mutex, QWidget *parent)
+    : QwtPlot(parent), detailEnabled_(false), minuteRetention_(0), hourRetention_(0), data_(new LoggerSeriesData(series, mutex)),
+      hasYRange_(false), yLower_(0.0), yUpper_(0.0), tileUseCounter_(0) {
     setAutoReplot(true);
 
     QwtPlotGrid *grid = new QwtPlotGrid();
@@ -31,11 +263,16 @@ Plot::Plot(QWidget *parent) : QwtPlot(parent) {
     setAxisTitle(QwtPlot::xBottom, "Time");
     setAxisTitle(QwtPlot::yLeft, "Temperature");
 
-    curve_ = new QwtPlotCurve();
+    curve_ = new SeriesCurve(data_);
     curve_->attach(this);
 
     QwtSymbol *symbol = new QwtSymbol(QwtSymbol::Ellipse, QColor(Qt::blue), QColor(Qt::blue), QSize(5, 5));
     curve_->setSymbol(symbol);
+
+    detailCurve_ = new QwtPlotCurve();
+    detailCurve_->setPen(QColor(Qt::darkBlue));
+    detailCurve_->setItemAttribute(QwtPlotItem::AutoScale, false);
+    detailCurve_->attach(this);
     
     
 #ifdef QWT_DATE_SCALE_DRAW_AVAILABLE
@@ -45,21 +282,146 @@ Plot::Plot(QWidget *parent) : QwtPlot(parent) {
 #endif
     
 
-    QwtPlotZoomer *zoomer = new QwtPlotZoomer(canvas());
-    zoomer->setRubberBandPen(QColor(Qt::black));
-    zoomer->setTrackerPen(QColor(Qt::black));
+    zoomer_ = new QwtPlotZoomer(canvas());
+    zoomer_->setRubberBandPen(QColor(Qt::black));
+    zoomer_->setTrackerPen(QColor(Qt::black));
+    // Back at the base of the zoom stack, follow the live series again after any panning.
+    connect(zoomer_, &QwtPlotZoomer::zoomed, this, [this](const QRectF &) {
+        if (zoomer_->zoomRectIndex() == 0) {
+            setAxisAutoScale(QwtPlot::xBottom);
+            if (hasYRange_) {
+                setAxisScale(QwtPlot::yLeft, yLower_, yUpper_);
+            }
+        }
+    });
 }
 
-void Plot::updatePlot(const QVector<QPair<qint64, double>> &data) {
+void Plot::refresh() {
+    QRectF bounds;
+    {
+        auto lock = data_->lock();
+        data_->update();
+        bounds = data_->boundingRect();
+    }
+    // An empty series reports negative bounds. While zoomed in, the user owns the y range.
+    bool hasData = bounds.width() >= 0.0 && bounds.height() >= 0.0;
+    if (hasData && zoomer_->zoomRectIndex() == 0 && updateYRange(bounds.top(), bounds.bottom())) {
+        setAxisScale(QwtPlot::yLeft, yLower_, yUpper_);
+    }
+    replot();
+}
 
-    QVector<double> xValues, yValues;
-    for (const auto &point : data) {
-        xValues.append(point.first / 1000.0);
-        yValues.append(point.second);
+// Grows the y range as soon as the series leaves it, but shrinks it only once the series
+// fills less than half of it, so small swings at the edges do not rescale the axis.
+bool Plot::updateYRange(double minY, double maxY) {
+    if (hasYRange_ && minY >= yLower_ && maxY <= yUpper_ && maxY - minY >= yShrinkFraction * (yUpper_ - yLower_)) {
+        return false;
     }
+    double margin = std::max(yMarginFraction * (maxY - minY), yMinimumMargin);
+    double lower = std::floor(minY - margin);
+    double upper = std::ceil(maxY + margin);
+    if (hasYRange_ && lower == yLower_ && upper == yUpper_) {
+        return false;
+    }
+    hasYRange_ = true;
+    yLower_ = lower;
+    yUpper_ = upper;
+    return true;
+}
 
-    curve_->setSamples(xValues, yValues);
-    setAxisScale(QwtPlot::yLeft, 0, 50);
-    replot();
+// Retention tells which rollup levels still cover a range; the source may announce it again.
+void Plot::enableDetailLoading(qint64 minuteRetention, qint64 hourRetention) {
+    minuteRetention_ = static_cast<time_t>(minuteRetention);
+    hourRetention_ = static_cast<time_t>(hourRetention);
+    if (detailEnabled_) {
+        return;
+    }
+    detailEnabled_ = true;
+
+    // Zooming and panning reach back past the live series; wheel magnification is x-only.
+    QwtPlotPanner *panner = new QwtPlotPanner(canvas());
+    panner->setMouseButton(Qt::MiddleButton);
+    QwtPlotMagnifier *magnifier = new QwtPlotMagnifier(canvas());
+    magnifier->setAxisEnabled(QwtPlot::yLeft, false);
+    connect(axisWidget(QwtPlot::xBottom), &QwtScaleWidget::scaleDivChanged, this, &Plot::updateDetail);
+}
+
+void Plot::addDetailTile(int level, qint64 from, const QVector<QPointF> &points) {
+    TileKey key(level, from);
+    pendingTiles_.remove(key);
+
+    // Buckets that may still grow are shown but fetched again on the next scale change.
+    DetailTile &tile = tiles_[key];
+    tile.points = points;
+    tile.complete = from + bucketsPerTile * rollupLevelSeconds(static_cast<RollupLevel>(level)) <= data_->boundingRect().left();
+    tile.lastUsed = ++tileUseCounter_;
+    evictTiles();
+    showDetail(false);
+}
+
+void Plot::updateDetail() {
+    showDetail(true);
+}
+
+// Only scale changes request tiles; an arriving tile just redraws, or an incomplete one
+// would be fetched again at once, forever.
+void Plot::showDetail(bool requestTiles) {
+    // As in refresh(), only negative bounds mean no data: a single point or a flat series
+    // has zero width or height, which QRectF::isValid() would reject.
+    QRectF live = data_->boundingRect();
+    bool hasLive = live.width() >= 0.0 && live.height() >= 0.0;
+    double from = axisScaleDiv(QwtPlot::xBottom).lowerBound();
+    double to = axisScaleDiv(QwtPlot::xBottom).upperBound();
+    double historyEnd = hasLive ? std::min(to, live.left()) : to;
+    if (!detailEnabled_ || from >= historyEnd) {
+        detailCurve_->setSamples(QVector<QPointF>());
+        return;
+    }
+
+    double now = hasLive ? live.right() : to;
+    int columns = std::max(1, canvas()->width());
+    RollupLevel level = RollupLevel::Day;
+    for (RollupLevel candidate : {RollupLevel::Minute, RollupLevel::Hour}) {
+        double seconds = static_cast<double>(rollupLevelSeconds(candidate));
+        time_t retention = candidate == RollupLevel::Minute ? minuteRetention_ : hourRetention_;
+        if ((to - from) / seconds <= 2.0 * columns && from >= now - static_cast<double>(retention)) {
+            level = candidate;
+            break;
+        }
+    }
+
+    qint64 tileSpan = static_cast<qint64>(bucketsPerTile) * rollupLevelSeconds(level);
+    qint64 firstTile = static_cast<qint64>(std::floor(from / tileSpan)) * tileSpan;
+    QVector<QPointF> points;
+    for (qint64 tileStart = firstTile; tileStart < historyEnd; tileStart += tileSpan) {
+        TileKey key(static_cast<int>(level), tileStart);
+        auto it = tiles_.find(key);
+        if (requestTiles && (it == tiles_.end() || !it->complete) && !pendingTiles_.contains(key)) {
+            pendingTiles_.insert(key);
+            emit detailRequested(static_cast<int>(level), tileStart, tileStart + tileSpan);
+        }
+        if (it == tiles_.end()) {
+            continue;
+        }
+
+        it->lastUsed = ++tileUseCounter_;
+        for (const auto &point : it->points) {
+            if (point.x() < historyEnd) {
+                points.append(point);
+            }
+        }
+    }
+    detailCurve_->setSamples(points);
 }
 
+void Plot::evictTiles() {
+    while (tiles_.size() > maxDetailTiles) {
+        auto oldest = tiles_.begin();
+        for (auto it = tiles_.begin(); it != tiles_.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        tiles_.erase(oldest);
+    }
+}
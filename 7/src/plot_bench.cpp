@@ -0,0 +1,272 @@
+#include "../include/mainwindow.h"
+#include "../include/plot.h"
+#include "../include/simulator.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QImage>
+#include <QPainter>
+#include <QTimer>
+#include <qwt_plot_renderer.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+static const int probeIntervalMs = 5;
+static const int loadIntervalMs = 100;
+static const int repeats = 20;
+static const char *const benchDbPath = "plot_bench.db";
+static const char *const benchSnapshotPath = "plot_bench.db.snapshot";
+
+struct LatencyStats {
+    size_t ticks;
+    double p50;
+    double p99;
+    double max;
+};
+
+static double peakRssMb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+static double currentRssMb() {
+    long pages = 0;
+    long resident = 0;
+    FILE *file = std::fopen("/proc/self/statm", "r");
+    if (file) {
+        if (std::fscanf(file, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(file);
+    }
+    return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+template <typename F>
+static double millisecondsOf(F &&work) {
+    auto begin = std::chrono::steady_clock::now();
+    work();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Runs the event loop for the given time with a 5 ms probe timer and reports how late its
+// ticks come; load, if set, runs every 100 ms on the same thread.
+static LatencyStats measureEventLoop(int milliseconds, const std::function<void()> &load) {
+    QEventLoop loop;
+    QElapsedTimer clock;
+    qint64 last = 0;
+    std::vector<double> lateness;
+
+    QTimer probe;
+    probe.setTimerType(Qt::PreciseTimer);
+    probe.setInterval(probeIntervalMs);
+    QObject::connect(&probe, &QTimer::timeout, [&]() {
+        qint64 now = clock.nsecsElapsed();
+        lateness.push_back(std::max(0.0, (now - last) / 1e6 - probeIntervalMs));
+        last = now;
+    });
+
+    QTimer loadTimer;
+    if (load) {
+        loadTimer.setInterval(loadIntervalMs);
+        QObject::connect(&loadTimer, &QTimer::timeout, load);
+        loadTimer.start();
+    }
+
+    QTimer::singleShot(milliseconds, &loop, &QEventLoop::quit);
+    clock.start();
+    probe.start();
+    loop.exec();
+
+    LatencyStats stats = {lateness.size(), 0.0, 0.0, 0.0};
+    if (!lateness.empty()) {
+        std::sort(lateness.begin(), lateness.end());
+        stats.p50 = lateness[lateness.size() / 2];
+        stats.p99 = lateness[std::min(lateness.size() - 1, lateness.size() * 99 / 100)];
+        stats.max = lateness.back();
+    }
+    return stats;
+}
+
+static void printLatency(const char *label, const LatencyStats &stats) {
+    std::printf("  %s: %zu ticks, lateness p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                label, stats.ticks, stats.p50, stats.p99, stats.max);
+}
+
+static void appendSamples(Simulator &simulator, time_t start, size_t count, ReadingSeries &series) {
+    const size_t batchSteps = 65536;
+    std::vector<Sample> batch(batchSteps);
+    for (size_t step = 0; step < count; step += batchSteps) {
+        size_t steps = std::min(batchSteps, count - step);
+        simulator.generate(start + static_cast<time_t>(step), 1, steps, batch.data());
+        for (size_t i = 0; i < steps; ++i) {
+            series.emplace_back(batch[i].timestamp, batch[i].value);
+        }
+    }
+}
+
+static void benchPlot(size_t points, int width, int height, int seconds) {
+    Simulator simulator(42);
+    time_t start = time(nullptr) - static_cast<time_t>(points);
+    simulator.addSensor(defaultSensorProfile(), start);
+
+    ReadingSeries series;
+    std::shared_mutex mutex;
+    double fillMs = millisecondsOf([&]() { appendSamples(simulator, start, points, series); });
+    time_t next = start + static_cast<time_t>(points);
+
+    Plot plot(series, mutex);
+    plot.resize(width, height);
+    plot.show();
+    QApplication::processEvents();
+
+    std::printf("%zu points (filled in %.1f ms, rss %.1f MB)\n", points, fillMs, currentRssMb());
+
+    double firstMs = millisecondsOf([&]() { plot.refresh(); });
+    std::printf("  first refresh: %.2f ms\n", firstMs);
+
+    // One new point per refresh, as the live window sees it.
+    double appendMs = 0.0;
+    for (int i = 0; i < repeats; ++i) {
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            appendSamples(simulator, next++, 1, series);
+        }
+        appendMs += millisecondsOf([&]() { plot.refresh(); });
+    }
+    std::printf("  refresh after append: %.2f ms\n", appendMs / repeats);
+
+    double replotMs = 0.0;
+    for (int i = 0; i < repeats; ++i) {
+        replotMs += millisecondsOf([&]() { plot.replot(); });
+    }
+    std::printf("  replot: %.2f ms\n", replotMs / repeats);
+
+    // The last hundredth of the series, where the view is not decimated for small sizes.
+    double to = static_cast<double>(next);
+    double from = to - static_cast<double>(points) / 100.0;
+    plot.setAxisScale(QwtPlot::xBottom, from, to);
+    double zoomedMs = 0.0;
+    for (int i = 0; i < repeats; ++i) {
+        zoomedMs += millisecondsOf([&]() { plot.replot(); });
+    }
+    std::printf("  replot zoomed to 1%%: %.2f ms\n", zoomedMs / repeats);
+    plot.setAxisAutoScale(QwtPlot::xBottom);
+
+    QwtPlotRenderer renderer;
+    QImage image(width, height, QImage::Format_ARGB32);
+    double renderMs = 0.0;
+    for (int i = 0; i < repeats; ++i) {
+        image.fill(Qt::white);
+        renderMs += millisecondsOf([&]() {
+            QPainter painter(&image);
+            renderer.render(&plot, &painter, image.rect());
+        });
+    }
+    std::printf("  render to QImage: %.2f ms\n", renderMs / repeats);
+
+    printLatency("event loop idle", measureEventLoop(seconds * 1000, std::function<void()>()));
+    printLatency("event loop with refresh every 100 ms", measureEventLoop(seconds * 1000, [&]() {
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            appendSamples(simulator, next++, 1, series);
+        }
+        plot.refresh();
+    }));
+
+    std::printf("  rss %.1f MB, peak %.1f MB\n", currentRssMb(), peakRssMb());
+}
+
+static void removeBenchDb() {
+    std::remove(benchDbPath);
+    std::remove(benchSnapshotPath);
+}
+
+static void runWindow(size_t prefill, int seconds) {
+    Logger logger(benchDbPath);
+
+    Simulator simulator(42);
+    time_t start = time(nullptr) - static_cast<time_t>(prefill);
+    simulator.addSensor(defaultSensorProfile(), start);
+    std::vector<Sample> samples;
+    simulator.generate(start, 1, prefill, samples);
+    for (const auto &sample : samples) {
+        logger.logSample(sample);
+    }
+
+    std::printf("main window (%zu prefilled samples, simulated acquisition)\n", prefill);
+    {
+        MainWindow window(logger);
+        QApplication::processEvents();
+        printLatency("event loop", measureEventLoop(seconds * 1000, std::function<void()>()));
+    }
+    std::printf("  rss %.1f MB, peak %.1f MB\n", currentRssMb(), peakRssMb());
+}
+
+// A snapshot left by an earlier run would be restored into the new database, and Logger
+// writes one on destruction, so both files go before and after the run.
+static void benchWindow(size_t prefill, int seconds) {
+    removeBenchDb();
+    runWindow(prefill, seconds);
+    removeBenchDb();
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<size_t> sizes = {10000, 100000, 1000000, 10000000};
+    int width = 1280;
+    int height = 400;
+    int seconds = 2;
+    size_t prefill = 10000;
+    // Long enough to cover a few of the window's 5 s refreshes.
+    int windowSeconds = 12;
+    bool window = true;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--points") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (char *token = std::strtok(argv[++i], ","); token; token = std::strtok(nullptr, ",")) {
+                sizes.push_back(std::strtoul(token, nullptr, 10));
+            }
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 2 < argc) {
+            width = std::atoi(argv[++i]);
+            height = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--prefill") == 0 && i + 1 < argc) {
+            prefill = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--window-seconds") == 0 && i + 1 < argc) {
+            windowSeconds = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--no-window") == 0) {
+            window = false;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--points N[,N...]] [--size WIDTH HEIGHT] [--seconds N] [--prefill N]"
+                      << " [--window-seconds N] [--no-window]" << std::endl;
+            return 1;
+        }
+    }
+
+    // Runs without a display unless a platform is chosen explicitly.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    for (size_t points : sizes) {
+        benchPlot(points, width, height, seconds);
+    }
+    if (window) {
+        benchWindow(prefill, windowSeconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,534 @@
+#include "../include/reading_partitions.h"
+#include "../include/compressed_block.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static const time_t secondsPerDay = 86400;
+static const size_t compressedBlockPoints = 3600;
+static const double centiDegreesPerDegree = 100.0;
+static const char *rowsPrefix = "all_readings_";
+static const char *blocksPrefix = "all_readings_blocks_";
+static const char *rowsSchema =
+    " (sensor_id INTEGER NOT NULL, time INTEGER NOT NULL, seq INTEGER NOT NULL DEFAULT 0, centi_degrees INTEGER NOT NULL, "
+    "PRIMARY KEY (sensor_id, time, seq)) WITHOUT ROWID;";
+
+ReadingPartitions::ReadingPartitions() : db_(nullptr), insertStmt_(nullptr), insertDay_(-1) {
+}
+
+ReadingPartitions::~ReadingPartitions() {
+    close();
+}
+
+void ReadingPartitions::open(sqlite3 *db) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    db_ = db;
+    discover();
+}
+
+void ReadingPartitions::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finalizeInsert();
+    partitions_.clear();
+    db_ = nullptr;
+}
+
+bool ReadingPartitions::insert(int sensorId, time_t time, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_ || !prepareInsert(dayStart(time))) {
+        return false;
+    }
+
+    sqlite3_reset(insertStmt_);
+    sqlite3_bind_int(insertStmt_, 1, sensorId);
+    sqlite3_bind_int64(insertStmt_, 2, time);
+    sqlite3_bind_int64(insertStmt_, 3, static_cast<sqlite3_int64>(std::llround(value * centiDegreesPerDegree)));
+
+    int rc = sqlite3_step(insertStmt_);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "SQL error during insert: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ReadingPartitions::read(int sensorId, time_t from, time_t to, ReadingSeries &series) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        return;
+    }
+
+    for (auto it = partitions_.begin(); it != partitions_.end() && it->first < to; ++it) {
+        if (it->first + secondsPerDay <= from) {
+            continue;
+        }
+
+        size_t first = series.size();
+        if (it->second.hasBlocks) {
+            readBlocks(it->first, sensorId, from, to, series);
+        }
+        if (it->second.hasRows) {
+            readRows(it->first, sensorId, from, to, series);
+        }
+
+        // Late samples land in a fresh row table after their day was compacted.
+        if (!std::is_sorted(series.begin() + first, series.end())) {
+            std::stable_sort(series.begin() + first, series.end(),
+                             [](const std::pair<time_t, double> &a, const std::pair<time_t, double> &b) { return a.first < b.first; });
+        }
+    }
+}
+
+size_t ReadingPartitions::compact(time_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        return 0;
+    }
+
+    std::vector<time_t> closedDays;
+    for (const auto &partition : partitions_) {
+        if (partition.second.hasRows && partition.first + secondsPerDay <= now) {
+            closedDays.push_back(partition.first);
+        }
+    }
+
+    size_t compacted = 0;
+    for (time_t day : closedDays) {
+        if (compactDay(day)) {
+            ++compacted;
+        }
+    }
+    return compacted;
+}
+
+size_t ReadingPartitions::dropBefore(time_t cutoff) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        return 0;
+    }
+
+    size_t dropped = 0;
+    while (!partitions_.empty() && partitions_.begin()->first + secondsPerDay <= cutoff) {
+        time_t day = partitions_.begin()->first;
+        if (day == insertDay_) {
+            finalizeInsert();
+        }
+        if (!exec("DROP TABLE IF EXISTS " + tableName(rowsPrefix, day) + ";") ||
+            !exec("DROP TABLE IF EXISTS " + tableName(blocksPrefix, day) + ";")) {
+            break;
+        }
+        partitions_.erase(partitions_.begin());
+        ++dropped;
+    }
+    return dropped;
+}
+
+size_t ReadingPartitions::getPartitionCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return partitions_.size();
+}
+
+time_t ReadingPartitions::dayStart(time_t time) {
+    time_t remainder = time % secondsPerDay;
+    return remainder < 0 ? time - remainder - secondsPerDay : time - remainder;
+}
+
+std::string ReadingPartitions::tableName(const char *prefix, time_t day) {
+    std::tm t;
+    gmtime_r(&day, &t);
+    char stamp[16];
+    strftime(stamp, sizeof(stamp), "%Y%m%d", &t);
+    return std::string(prefix) + stamp;
+}
+
+bool ReadingPartitions::parseTableName(const std::string &name, const char *prefix, time_t &day) {
+    size_t prefixLength = std::strlen(prefix);
+    if (name.size() != prefixLength + 8 || name.compare(0, prefixLength, prefix) != 0) {
+        return false;
+    }
+    for (size_t i = prefixLength; i < name.size(); ++i) {
+        if (name[i] < '0' || name[i] > '9') {
+            return false;
+        }
+    }
+
+    std::tm t = {};
+    if (std::sscanf(name.c_str() + prefixLength, "%4d%2d%2d", &t.tm_year, &t.tm_mon, &t.tm_mday) != 3) {
+        return false;
+    }
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    day = timegm(&t);
+    return true;
+}
+
+bool ReadingPartitions::exec(const std::string &sql) {
+    char *errMsg = nullptr;
+    int rc = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Commits if every step succeeded. Otherwise, or if the commit fails, rolls back and
+// re-reads the partition list, which the failed steps may have changed.
+bool ReadingPartitions::endTransaction(bool ok) {
+    if (ok && exec("COMMIT;")) {
+        return true;
+    }
+    exec("ROLLBACK;");
+    discover();
+    return false;
+}
+
+bool ReadingPartitions::hasColumn(const std::string &table, const char *column) {
+    std::string sql = "PRAGMA table_info(" + table + ");";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        found = std::strcmp(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)), column) == 0;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+void ReadingPartitions::discover() {
+    partitions_.clear();
+
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db_, "SELECT name FROM sqlite_master WHERE type = 'table' AND name LIKE 'all\\_readings\\_%' ESCAPE '\\';",
+                                -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        std::string name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+        time_t day;
+        if (parseTableName(name, blocksPrefix, day)) {
+            Partition &partition = partitions_.emplace(day, Partition{false, false}).first->second;
+            partition.hasBlocks = true;
+        } else if (parseTableName(name, rowsPrefix, day)) {
+            Partition &partition = partitions_.emplace(day, Partition{false, false}).first->second;
+            partition.hasRows = true;
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+}
+
+bool ReadingPartitions::migrateLegacyTables() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool hasRows = false;
+    bool hasBlocks = false;
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db_, "SELECT name FROM sqlite_master WHERE type = 'table' AND name IN ('all_readings', 'all_readings_blocks');",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        std::string name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+        hasRows = hasRows || name == "all_readings";
+        hasBlocks = hasBlocks || name == "all_readings_blocks";
+    }
+    sqlite3_finalize(stmt);
+    if (!hasRows && !hasBlocks) {
+        return true;
+    }
+
+    bool ok = exec("BEGIN;");
+
+    if (hasRows) {
+        std::vector<time_t> days;
+        if (sqlite3_prepare_v2(db_, "SELECT DISTINCT time - time % 86400 FROM all_readings;", -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                days.push_back(static_cast<time_t>(sqlite3_column_int64(stmt, 0)));
+            }
+            sqlite3_finalize(stmt);
+        }
+
+        for (time_t day : days) {
+            ok = ok && ensureRows(day) &&
+                 exec("INSERT OR REPLACE INTO " + tableName(rowsPrefix, day) +
+                      " (sensor_id, time, centi_degrees) SELECT 0, time, CAST(ROUND(temperature * 100) AS INTEGER) FROM all_readings WHERE time >= " +
+                      std::to_string(day) + " AND time < " + std::to_string(day + secondsPerDay) + ";");
+        }
+        ok = ok && exec("DROP TABLE all_readings;");
+    }
+
+    if (hasBlocks) {
+        std::vector<time_t> days;
+        if (sqlite3_prepare_v2(db_, "SELECT DISTINCT start_time - start_time % 86400 FROM all_readings_blocks;", -1, &stmt, nullptr) == SQLITE_OK) {
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                days.push_back(static_cast<time_t>(sqlite3_column_int64(stmt, 0)));
+            }
+            sqlite3_finalize(stmt);
+        }
+
+        for (time_t day : days) {
+            ok = ok && ensureBlocks(day) &&
+                 exec("INSERT INTO " + tableName(blocksPrefix, day) +
+                      " (sensor_id, start_time, end_time, count, data) SELECT 0, start_time, end_time, count, data FROM all_readings_blocks WHERE start_time >= " +
+                      std::to_string(day) + " AND start_time < " + std::to_string(day + secondsPerDay) + ";");
+        }
+        ok = ok && exec("DROP TABLE all_readings_blocks;");
+    }
+
+    if (!endTransaction(ok)) {
+        std::cerr << "Migration of all_readings into daily partitions failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReadingPartitions::migrateRowSchema() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finalizeInsert();
+
+    bool ok = exec("BEGIN;");
+    for (const auto &partition : partitions_) {
+        std::string rowsTable = tableName(rowsPrefix, partition.first);
+        if (ok && partition.second.hasRows && !hasColumn(rowsTable, "centi_degrees")) {
+            ok = exec("ALTER TABLE " + rowsTable + " RENAME TO " + rowsTable + "_old;") &&
+                 exec("CREATE TABLE " + rowsTable + rowsSchema) &&
+                 exec("INSERT OR REPLACE INTO " + rowsTable +
+                      " (sensor_id, time, centi_degrees) SELECT 0, time, CAST(ROUND(temperature * 100) AS INTEGER) FROM " + rowsTable + "_old;") &&
+                 exec("DROP TABLE " + rowsTable + "_old;");
+        }
+
+        std::string blocksTable = tableName(blocksPrefix, partition.first);
+        if (ok && partition.second.hasBlocks && !hasColumn(blocksTable, "sensor_id")) {
+            ok = exec("ALTER TABLE " + blocksTable + " ADD COLUMN sensor_id INTEGER NOT NULL DEFAULT 0;");
+        }
+    }
+
+    if (!endTransaction(ok)) {
+        std::cerr << "Migration of daily partitions to the WITHOUT ROWID schema failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReadingPartitions::migrateRowSequence() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finalizeInsert();
+
+    bool ok = exec("BEGIN;");
+    for (const auto &partition : partitions_) {
+        std::string rowsTable = tableName(rowsPrefix, partition.first);
+        if (ok && partition.second.hasRows && !hasColumn(rowsTable, "seq")) {
+            ok = exec("ALTER TABLE " + rowsTable + " RENAME TO " + rowsTable + "_old;") &&
+                 exec("CREATE TABLE " + rowsTable + rowsSchema) &&
+                 exec("INSERT INTO " + rowsTable + " (sensor_id, time, seq, centi_degrees) SELECT sensor_id, time, 0, centi_degrees FROM " +
+                      rowsTable + "_old;") &&
+                 exec("DROP TABLE " + rowsTable + "_old;");
+        }
+    }
+
+    if (!endTransaction(ok)) {
+        std::cerr << "Migration of daily partitions to per-second sequence keys failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ReadingPartitions::ensureRows(time_t day) {
+    auto it = partitions_.find(day);
+    if (it != partitions_.end() && it->second.hasRows) {
+        return true;
+    }
+    if (!exec("CREATE TABLE IF NOT EXISTS " + tableName(rowsPrefix, day) + rowsSchema)) {
+        return false;
+    }
+    partitions_.emplace(day, Partition{false, false}).first->second.hasRows = true;
+    return true;
+}
+
+bool ReadingPartitions::ensureBlocks(time_t day) {
+    auto it = partitions_.find(day);
+    if (it != partitions_.end() && it->second.hasBlocks) {
+        return true;
+    }
+    if (!exec("CREATE TABLE IF NOT EXISTS " + tableName(blocksPrefix, day) +
+              " (sensor_id INTEGER NOT NULL, start_time INTEGER NOT NULL, end_time INTEGER NOT NULL, count INTEGER NOT NULL, data BLOB NOT NULL);")) {
+        return false;
+    }
+    partitions_.emplace(day, Partition{false, false}).first->second.hasBlocks = true;
+    return true;
+}
+
+bool ReadingPartitions::prepareInsert(time_t day) {
+    if (insertStmt_ && insertDay_ == day) {
+        return true;
+    }
+
+    finalizeInsert();
+    if (!ensureRows(day)) {
+        return false;
+    }
+
+    // Samples come several per second, so seq numbers the rows within one second; it is
+    // taken from the table, not counted here, so it carries on across restarts.
+    std::string rowsTable = tableName(rowsPrefix, day);
+    std::string insertSQL = "INSERT INTO " + rowsTable + " (sensor_id, time, seq, centi_degrees) SELECT ?1, ?2, COALESCE(MAX(seq) + 1, 0), ?3 FROM " +
+                            rowsTable + " WHERE sensor_id = ?1 AND time = ?2;";
+    int rc = sqlite3_prepare_v2(db_, insertSQL.c_str(), -1, &insertStmt_, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Error preparing insert statement: " << sqlite3_errmsg(db_) << std::endl;
+        insertStmt_ = nullptr;
+        return false;
+    }
+    insertDay_ = day;
+    return true;
+}
+
+void ReadingPartitions::finalizeInsert() {
+    if (insertStmt_) {
+        sqlite3_finalize(insertStmt_);
+        insertStmt_ = nullptr;
+    }
+    insertDay_ = -1;
+}
+
+bool ReadingPartitions::compactDay(time_t day) {
+    if (day == insertDay_) {
+        finalizeInsert();
+    }
+
+    // A closed day moves from its row table into one compressed block per hour, and the
+    // row table is dropped rather than emptied.
+    std::string rowsTable = tableName(rowsPrefix, day);
+    std::string selectSQL = "SELECT sensor_id, time, centi_degrees FROM " + rowsTable + " ORDER BY sensor_id, time, seq;";
+    sqlite3_stmt *selectStmt;
+    if (sqlite3_prepare_v2(db_, selectSQL.c_str(), -1, &selectStmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing compaction select statement: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+
+    bool ok = exec("BEGIN;") && ensureBlocks(day);
+
+    sqlite3_stmt *insertStmt = nullptr;
+    std::string insertSQL = "INSERT INTO " + tableName(blocksPrefix, day) + " (sensor_id, start_time, end_time, count, data) VALUES (?, ?, ?, ?, ?);";
+    if (ok && sqlite3_prepare_v2(db_, insertSQL.c_str(), -1, &insertStmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing compaction insert statement: " << sqlite3_errmsg(db_) << std::endl;
+        ok = false;
+    }
+
+    BlockEncoder encoder;
+    std::string data;
+    int sensorId = 0;
+    auto insertBlock = [&]() {
+        if (encoder.size() == 0) {
+            return;
+        }
+        data.clear();
+        encoder.encode(data);
+        sqlite3_reset(insertStmt);
+        sqlite3_bind_int(insertStmt, 1, sensorId);
+        sqlite3_bind_int64(insertStmt, 2, encoder.firstTime());
+        sqlite3_bind_int64(insertStmt, 3, encoder.lastTime());
+        sqlite3_bind_int64(insertStmt, 4, static_cast<sqlite3_int64>(encoder.size()));
+        sqlite3_bind_blob(insertStmt, 5, data.data(), static_cast<int>(data.size()), SQLITE_STATIC);
+        if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+            std::cerr << "SQL error during block insert: " << sqlite3_errmsg(db_) << std::endl;
+            ok = false;
+        }
+        encoder.clear();
+    };
+
+    int rc = SQLITE_DONE;
+    while (ok && (rc = sqlite3_step(selectStmt)) == SQLITE_ROW) {
+        int rowSensorId = sqlite3_column_int(selectStmt, 0);
+        time_t time = static_cast<time_t>(sqlite3_column_int64(selectStmt, 1));
+        if (encoder.size() > 0 && (rowSensorId != sensorId || time / 3600 != encoder.firstTime() / 3600 ||
+                                   encoder.size() >= compressedBlockPoints)) {
+            insertBlock();
+        }
+        sensorId = rowSensorId;
+        encoder.append(time, sqlite3_column_int64(selectStmt, 2) / centiDegreesPerDegree);
+    }
+    if (ok && rc != SQLITE_DONE) {
+        std::cerr << "Error reading " << rowsTable << ": " << sqlite3_errmsg(db_) << std::endl;
+        ok = false;
+    }
+    if (ok) {
+        insertBlock();
+    }
+    sqlite3_finalize(selectStmt);
+    if (insertStmt) {
+        sqlite3_finalize(insertStmt);
+    }
+
+    ok = ok && exec("DROP TABLE " + rowsTable + ";");
+    if (!endTransaction(ok)) {
+        std::cerr << "Compaction of " << rowsTable << " failed" << std::endl;
+        return false;
+    }
+    partitions_[day].hasRows = false;
+    return true;
+}
+
+void ReadingPartitions::readBlocks(time_t day, int sensorId, time_t from, time_t to, ReadingSeries &series) {
+    std::string blocksSQL = "SELECT data FROM " + tableName(blocksPrefix, day) +
+                            " WHERE sensor_id = ? AND end_time >= ? AND start_time < ? ORDER BY start_time;";
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db_, blocksSQL.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, from);
+    sqlite3_bind_int64(stmt, 3, to);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        BlockDecoder decoder(static_cast<const char *>(sqlite3_column_blob(stmt, 0)), static_cast<size_t>(sqlite3_column_bytes(stmt, 0)));
+        time_t time;
+        double value;
+        while (decoder.next(time, value) && time < to) {
+            if (time >= from) {
+                series.push_back(std::make_pair(time, value));
+            }
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+}
+
+void ReadingPartitions::readRows(time_t day, int sensorId, time_t from, time_t to, ReadingSeries &series) {
+    std::string rowsSQL = "SELECT time, centi_degrees FROM " + tableName(rowsPrefix, day) +
+                          " WHERE sensor_id = ? AND time >= ? AND time < ? ORDER BY time, seq;";
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db_, rowsSQL.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, from);
+    sqlite3_bind_int64(stmt, 3, to);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        series.push_back(std::make_pair(static_cast<time_t>(sqlite3_column_int64(stmt, 0)), sqlite3_column_int64(stmt, 1) / centiDegreesPerDegree));
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+}
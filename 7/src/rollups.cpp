@@ -0,0 +1,502 @@
+#include "../include/rollups.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
+
+static const char *rollupTables[] = {"rollup_1m", "rollup_1h", "rollup_1d"};
+
+void RollupBucket::add(double value) {
+    ++count;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    sumSquares += value * value;
+    sketch.add(value);
+}
+
+void RollupBucket::merge(const RollupBucket &other) {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sumSquares += other.sumSquares;
+    sketch.merge(other.sketch);
+}
+
+double RollupBucket::mean() const {
+    return count > 0 ? sum / count : 0.0;
+}
+
+double RollupBucket::stddev() const {
+    if (count < 2) {
+        return 0.0;
+    }
+    double variance = (sumSquares - sum * sum / count) / (count - 1);
+    return variance > 0.0 ? std::sqrt(variance) : 0.0;
+}
+
+RollupBucket emptyRollupBucket(time_t start) {
+    RollupBucket bucket;
+    bucket.start = start;
+    bucket.count = 0;
+    bucket.sum = 0.0;
+    bucket.min = std::numeric_limits<double>::infinity();
+    bucket.max = -std::numeric_limits<double>::infinity();
+    bucket.sumSquares = 0.0;
+    return bucket;
+}
+
+time_t rollupLevelSeconds(RollupLevel level) {
+    switch (level) {
+    case RollupLevel::Minute:
+        return 60;
+    case RollupLevel::Hour:
+        return 3600;
+    case RollupLevel::Day:
+        return 86400;
+    }
+    return 60;
+}
+
+static time_t bucketStart(time_t time, time_t seconds) {
+    return time - (time % seconds);
+}
+
+Rollups::Rollups()
+    : db_(nullptr), mergeMinuteStmt_(nullptr), refreshHourStmt_(nullptr), refreshDayStmt_(nullptr), selectHourSketchStmt_(nullptr),
+      updateHourSketchStmt_(nullptr), selectDaySketchesStmt_(nullptr), updateDaySketchStmt_(nullptr) {
+}
+
+Rollups::~Rollups() {
+    close();
+}
+
+void Rollups::open(sqlite3 *db) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    db_ = db;
+
+    for (const char *table : rollupTables) {
+        bool hasSketch = table != rollupTables[0];
+        std::string sql = std::string("CREATE TABLE IF NOT EXISTS ") + table +
+                          " (sensor_id INTEGER NOT NULL, bucket INTEGER NOT NULL, count INTEGER NOT NULL, sum REAL NOT NULL,"
+                          " min REAL NOT NULL, max REAL NOT NULL, sumsq REAL NOT NULL" +
+                          (hasSketch ? ", sketch BLOB" : "") + ", PRIMARY KEY (sensor_id, bucket)) WITHOUT ROWID;";
+        exec(sql.c_str());
+    }
+
+    // Tables from before schema version 4 get their sketch columns in addSketchColumns.
+    if (hasColumn(rollupTables[1], "sketch") && hasColumn(rollupTables[2], "sketch")) {
+        prepareStatements();
+    }
+}
+
+bool Rollups::addSketchColumns() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        return false;
+    }
+
+    for (const char *table : {rollupTables[1], rollupTables[2]}) {
+        std::string sql = std::string("ALTER TABLE ") + table + " ADD COLUMN sketch BLOB;";
+        if (!hasColumn(table, "sketch") && !exec(sql.c_str())) {
+            return false;
+        }
+    }
+
+    finalizeStatements();
+    return prepareStatements();
+}
+
+void Rollups::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finalizeStatements();
+    open_.clear();
+    db_ = nullptr;
+}
+
+void Rollups::add(int sensorId, time_t time, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    time_t minute = bucketStart(time, 60);
+    auto it = open_.find(sensorId);
+    if (it == open_.end()) {
+        it = open_.emplace(sensorId, emptyRollupBucket(minute)).first;
+    } else if (it->second.start != minute) {
+        exec("BEGIN;");
+        writeMinute(sensorId, it->second);
+        exec("COMMIT;");
+        it->second = emptyRollupBucket(minute);
+    }
+    it->second.add(value);
+}
+
+void Rollups::rebuild(int sensorId, const ReadingSeries &series) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        return;
+    }
+
+    exec("BEGIN;");
+    for (const char *table : rollupTables) {
+        std::string sql = std::string("DELETE FROM ") + table + " WHERE sensor_id = " + std::to_string(sensorId) + ";";
+        exec(sql.c_str());
+    }
+
+    RollupBucket bucket = emptyRollupBucket(0);
+    for (const auto &reading : series) {
+        time_t minute = bucketStart(reading.first, 60);
+        if (bucket.count > 0 && bucket.start != minute) {
+            writeMinute(sensorId, bucket);
+        }
+        if (bucket.start != minute || bucket.count == 0) {
+            bucket = emptyRollupBucket(minute);
+        }
+        bucket.add(reading.second);
+    }
+    if (bucket.count > 0) {
+        writeMinute(sensorId, bucket);
+    }
+    exec("COMMIT;");
+}
+
+// Gives the hours the readings cover a sketch, and re-merges their days, leaving the
+// count/sum/min/max columns alone. An hour only partly covered gets a partial sketch.
+void Rollups::backfillSketches(int sensorId, const ReadingSeries &series) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_ || !selectHourSketchStmt_) {
+        return;
+    }
+
+    exec("BEGIN;");
+    TDigest sketch;
+    time_t hour = 0;
+    time_t lastDay = 0;
+    bool hasDay = false;
+    auto writeHour = [&]() {
+        mergeSketches(selectHourSketchStmt_, updateHourSketchStmt_, sensorId, hour, 3600, &sketch);
+        time_t day = bucketStart(hour, 86400);
+        if (hasDay && day != lastDay) {
+            mergeSketches(selectDaySketchesStmt_, updateDaySketchStmt_, sensorId, lastDay, 86400, nullptr);
+        }
+        lastDay = day;
+        hasDay = true;
+    };
+    for (const auto &reading : series) {
+        time_t readingHour = bucketStart(reading.first, 3600);
+        if (!sketch.empty() && readingHour != hour) {
+            writeHour();
+            sketch.clear();
+        }
+        hour = readingHour;
+        sketch.add(reading.second);
+    }
+    if (!sketch.empty()) {
+        writeHour();
+    }
+    if (hasDay) {
+        mergeSketches(selectDaySketchesStmt_, updateDaySketchStmt_, sensorId, lastDay, 86400, nullptr);
+    }
+    exec("COMMIT;");
+}
+
+void Rollups::flushClosed(time_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushBuckets(true, now);
+}
+
+void Rollups::flushAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushBuckets(false, 0);
+}
+
+void Rollups::expire(time_t minuteCutoff, time_t hourCutoff, time_t dayCutoff) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!db_) {
+        return;
+    }
+
+    const time_t cutoffs[] = {minuteCutoff, hourCutoff, dayCutoff};
+    for (int i = 0; i < 3; ++i) {
+        std::string sql = std::string("DELETE FROM ") + rollupTables[i] + " WHERE bucket < " + std::to_string(cutoffs[i]) + ";";
+        exec(sql.c_str());
+    }
+}
+
+std::vector<RollupBucket> Rollups::query(RollupLevel level, int sensorId, time_t from, time_t to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<RollupBucket> buckets;
+    if (!db_) {
+        return buckets;
+    }
+
+    bool hasSketch = level != RollupLevel::Minute;
+    std::string sql = std::string("SELECT bucket, count, sum, min, max, sumsq") + (hasSketch ? ", sketch" : "") + " FROM " +
+                      rollupTables[static_cast<int>(level)] + " WHERE sensor_id = ? AND bucket >= ? AND bucket < ? ORDER BY bucket;";
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
+        return buckets;
+    }
+
+    // Include the bucket that contains from; it may start before it.
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, from == std::numeric_limits<time_t>::min() ? from : bucketStart(from, rollupLevelSeconds(level)));
+    sqlite3_bind_int64(stmt, 3, to);
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        RollupBucket bucket;
+        bucket.start = static_cast<time_t>(sqlite3_column_int64(stmt, 0));
+        bucket.count = sqlite3_column_int64(stmt, 1);
+        bucket.sum = sqlite3_column_double(stmt, 2);
+        bucket.min = sqlite3_column_double(stmt, 3);
+        bucket.max = sqlite3_column_double(stmt, 4);
+        bucket.sumSquares = sqlite3_column_double(stmt, 5);
+        if (hasSketch) {
+            bucket.sketch.deserialize(static_cast<const char *>(sqlite3_column_blob(stmt, 6)), sqlite3_column_bytes(stmt, 6));
+        }
+        buckets.push_back(bucket);
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Error during SQL query: " << sqlite3_errmsg(db_) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+    return buckets;
+}
+
+std::vector<RollupBucket> Rollups::aggregate(int sensorId, time_t from, time_t to, time_t step) {
+    std::vector<RollupBucket> result;
+    if (step <= 0 || step % 60 != 0) {
+        return result;
+    }
+
+    RollupLevel level = RollupLevel::Minute;
+    if (step % 86400 == 0) {
+        level = RollupLevel::Day;
+    } else if (step % 3600 == 0) {
+        level = RollupLevel::Hour;
+    }
+
+    for (const auto &bucket : query(level, sensorId, from, to)) {
+        time_t start = bucketStart(bucket.start, step);
+        if (result.empty() || result.back().start != start) {
+            result.push_back(emptyRollupBucket(start));
+        }
+        result.back().merge(bucket);
+    }
+    return result;
+}
+
+TDigest Rollups::sketch(int sensorId, time_t from, time_t to) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TDigest sketch;
+    if (!db_) {
+        return sketch;
+    }
+
+    // Whole days come from rollup_1d, the partial days at either end from rollup_1h.
+    time_t start = from == std::numeric_limits<time_t>::min() ? from : bucketStart(from, 3600);
+    time_t firstDay = start == std::numeric_limits<time_t>::min() ? start : bucketStart(start + 86399, 86400);
+    time_t lastDay = bucketStart(to, 86400);
+    if (firstDay < lastDay) {
+        readSketches(rollupTables[1], sensorId, start, firstDay, sketch);
+        readSketches(rollupTables[2], sensorId, firstDay, lastDay, sketch);
+        readSketches(rollupTables[1], sensorId, lastDay, to, sketch);
+    } else {
+        readSketches(rollupTables[1], sensorId, start, to, sketch);
+    }
+    return sketch;
+}
+
+bool Rollups::exec(const char *sql) {
+    char *errMsg = nullptr;
+    int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool Rollups::hasColumn(const char *table, const char *column) {
+    std::string sql = std::string("PRAGMA table_info(") + table + ");";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        found = std::strcmp(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1)), column) == 0;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool Rollups::prepareStatements() {
+    const char *mergeMinuteSQL =
+        "INSERT INTO rollup_1m (sensor_id, bucket, count, sum, min, max, sumsq) VALUES (?, ?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT (sensor_id, bucket) DO UPDATE SET count = count + excluded.count, sum = sum + excluded.sum, "
+        "min = MIN(min, excluded.min), max = MAX(max, excluded.max), sumsq = sumsq + excluded.sumsq;";
+    // Upserts rather than replaces so the parent's sketch survives the refresh.
+    const char *refreshHourSQL =
+        "INSERT INTO rollup_1h (sensor_id, bucket, count, sum, min, max, sumsq) "
+        "SELECT sensor_id, ?2, SUM(count), SUM(sum), MIN(min), MAX(max), SUM(sumsq) FROM rollup_1m "
+        "WHERE sensor_id = ?1 AND bucket >= ?2 AND bucket < ?3 GROUP BY sensor_id "
+        "ON CONFLICT (sensor_id, bucket) DO UPDATE SET count = excluded.count, sum = excluded.sum, "
+        "min = excluded.min, max = excluded.max, sumsq = excluded.sumsq;";
+    const char *refreshDaySQL =
+        "INSERT INTO rollup_1d (sensor_id, bucket, count, sum, min, max, sumsq) "
+        "SELECT sensor_id, ?2, SUM(count), SUM(sum), MIN(min), MAX(max), SUM(sumsq) FROM rollup_1h "
+        "WHERE sensor_id = ?1 AND bucket >= ?2 AND bucket < ?3 GROUP BY sensor_id "
+        "ON CONFLICT (sensor_id, bucket) DO UPDATE SET count = excluded.count, sum = excluded.sum, "
+        "min = excluded.min, max = excluded.max, sumsq = excluded.sumsq;";
+    const char *selectHourSketchSQL = "SELECT sketch FROM rollup_1h WHERE sensor_id = ?1 AND bucket >= ?2 AND bucket < ?3;";
+    const char *updateHourSketchSQL = "UPDATE rollup_1h SET sketch = ?3 WHERE sensor_id = ?1 AND bucket = ?2;";
+    const char *updateDaySketchSQL = "UPDATE rollup_1d SET sketch = ?3 WHERE sensor_id = ?1 AND bucket = ?2;";
+
+    if (sqlite3_prepare_v2(db_, mergeMinuteSQL, -1, &mergeMinuteStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, refreshHourSQL, -1, &refreshHourStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, refreshDaySQL, -1, &refreshDayStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, selectHourSketchSQL, -1, &selectHourSketchStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, updateHourSketchSQL, -1, &updateHourSketchStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, selectHourSketchSQL, -1, &selectDaySketchesStmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, updateDaySketchSQL, -1, &updateDaySketchStmt_, nullptr) != SQLITE_OK) {
+        std::cerr << "Error preparing rollup statements: " << sqlite3_errmsg(db_) << std::endl;
+        finalizeStatements();
+        return false;
+    }
+    return true;
+}
+
+void Rollups::finalizeStatements() {
+    sqlite3_stmt **statements[] = {&mergeMinuteStmt_,       &refreshHourStmt_,      &refreshDayStmt_,      &selectHourSketchStmt_,
+                                   &updateHourSketchStmt_, &selectDaySketchesStmt_, &updateDaySketchStmt_};
+    for (sqlite3_stmt **stmt : statements) {
+        if (*stmt) {
+            sqlite3_finalize(*stmt);
+            *stmt = nullptr;
+        }
+    }
+}
+
+bool Rollups::writeMinute(int sensorId, const RollupBucket &bucket) {
+    if (!db_ || !mergeMinuteStmt_) {
+        return false;
+    }
+
+    sqlite3_reset(mergeMinuteStmt_);
+    sqlite3_bind_int(mergeMinuteStmt_, 1, sensorId);
+    sqlite3_bind_int64(mergeMinuteStmt_, 2, bucket.start);
+    sqlite3_bind_int64(mergeMinuteStmt_, 3, bucket.count);
+    sqlite3_bind_double(mergeMinuteStmt_, 4, bucket.sum);
+    sqlite3_bind_double(mergeMinuteStmt_, 5, bucket.min);
+    sqlite3_bind_double(mergeMinuteStmt_, 6, bucket.max);
+    sqlite3_bind_double(mergeMinuteStmt_, 7, bucket.sumSquares);
+    if (sqlite3_step(mergeMinuteStmt_) != SQLITE_DONE) {
+        std::cerr << "SQL error during rollup insert: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+
+    time_t hour = bucketStart(bucket.start, 3600);
+    time_t day = bucketStart(bucket.start, 86400);
+    return refreshParent(refreshHourStmt_, sensorId, hour, 3600) &&
+           mergeSketches(selectHourSketchStmt_, updateHourSketchStmt_, sensorId, hour, 3600, &bucket.sketch) &&
+           refreshParent(refreshDayStmt_, sensorId, day, 86400) &&
+           mergeSketches(selectDaySketchesStmt_, updateDaySketchStmt_, sensorId, day, 86400, nullptr);
+}
+
+bool Rollups::refreshParent(sqlite3_stmt *stmt, int sensorId, time_t start, time_t seconds) {
+    sqlite3_reset(stmt);
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, start);
+    sqlite3_bind_int64(stmt, 3, start + seconds);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        std::cerr << "SQL error during rollup refresh: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Rollups::mergeSketches(sqlite3_stmt *select, sqlite3_stmt *update, int sensorId, time_t start, time_t seconds, const TDigest *extra) {
+    TDigest merged;
+    sqlite3_reset(select);
+    sqlite3_bind_int(select, 1, sensorId);
+    sqlite3_bind_int64(select, 2, start);
+    sqlite3_bind_int64(select, 3, start + seconds);
+    int rc;
+    while ((rc = sqlite3_step(select)) == SQLITE_ROW) {
+        TDigest stored;
+        if (stored.deserialize(static_cast<const char *>(sqlite3_column_blob(select, 0)), sqlite3_column_bytes(select, 0))) {
+            merged.merge(stored);
+        }
+    }
+    if (rc != SQLITE_DONE) {
+        std::cerr << "SQL error during sketch read: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    if (extra) {
+        merged.merge(*extra);
+    }
+
+    std::string data;
+    merged.serialize(data);
+    sqlite3_reset(update);
+    sqlite3_bind_int(update, 1, sensorId);
+    sqlite3_bind_int64(update, 2, start);
+    sqlite3_bind_blob(update, 3, data.data(), static_cast<int>(data.size()), SQLITE_TRANSIENT);
+    if (sqlite3_step(update) != SQLITE_DONE) {
+        std::cerr << "SQL error during sketch update: " << sqlite3_errmsg(db_) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Rollups::readSketches(const char *table, int sensorId, time_t from, time_t to, TDigest &sketch) {
+    if (from >= to) {
+        return;
+    }
+
+    std::string sql = std::string("SELECT sketch FROM ") + table + " WHERE sensor_id = ? AND bucket >= ? AND bucket < ?;";
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        std::cerr << "Failed to prepare SQL: " << sqlite3_errmsg(db_) << std::endl;
+        return;
+    }
+
+    sqlite3_bind_int(stmt, 1, sensorId);
+    sqlite3_bind_int64(stmt, 2, from);
+    sqlite3_bind_int64(stmt, 3, to);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        TDigest stored;
+        if (stored.deserialize(static_cast<const char *>(sqlite3_column_blob(stmt, 0)), sqlite3_column_bytes(stmt, 0))) {
+            sketch.merge(stored);
+        }
+    }
+    sqlite3_finalize(stmt);
+}
+
+void Rollups::flushBuckets(bool closedOnly, time_t now) {
+    if (!db_ || open_.empty()) {
+        return;
+    }
+
+    bool started = false;
+    for (auto it = open_.begin(); it != open_.end();) {
+        if (closedOnly && it->second.start + 60 > now) {
+            ++it;
+            continue;
+        }
+        if (!started) {
+            exec("BEGIN;");
+            started = true;
+        }
+        writeMinute(it->first, it->second);
+        it = open_.erase(it);
+    }
+    if (started) {
+        exec("COMMIT;");
+    }
+}
@@ -0,0 +1,108 @@
+#include "../include/sample_parser.h"
+#include "../include/temperature_parser.h"
+#include <iostream>
+
+static const size_t maxLineLength = 64;
+
+SampleParser::SampleParser(int sensorId) : sensorId_(sensorId), rejectedLines_(0) {
+}
+
+size_t SampleParser::feed(const char *data, size_t size, std::vector<Sample> &samples) {
+    size_t before = samples.size();
+    const char *end = data + size;
+    const char *lineStart = data;
+
+    for (const char *p = data; p != end; ++p) {
+        if (*p != '\n') {
+            continue;
+        }
+
+        if (pending_.empty()) {
+            parseLine(lineStart, p, samples);
+        } else {
+            pending_.append(lineStart, p);
+            parseLine(pending_.data(), pending_.data() + pending_.size(), samples);
+            pending_.clear();
+        }
+        lineStart = p + 1;
+    }
+
+    pending_.append(lineStart, end);
+    if (pending_.size() > maxLineLength) {
+        ++rejectedLines_;
+        pending_.clear();
+    }
+
+    return samples.size() - before;
+}
+
+size_t SampleParser::feed(const std::string &data, std::vector<Sample> &samples) {
+    return feed(data.data(), data.size(), samples);
+}
+
+unsigned long long SampleParser::getRejectedLines() const {
+    return rejectedLines_;
+}
+
+void SampleParser::parseLine(const char *begin, const char *end, std::vector<Sample> &samples) {
+    time_t timestamp = 0;
+    const char *comma = begin;
+    while (comma != end && *comma != ',') {
+        ++comma;
+    }
+
+    ParseStatus status = ParseStatus::Ok;
+    if (comma != end) {
+        status = parseTimestamp(begin, comma, timestamp);
+        begin = comma + 1;
+    }
+
+    double value = 0.0;
+    if (status == ParseStatus::Ok) {
+        status = parseTemperature(begin, end, value);
+    }
+    if (status == ParseStatus::Empty && comma == end) {
+        return;
+    }
+    if (status != ParseStatus::Ok) {
+        ++rejectedLines_;
+        if (rejectedLines_ == 1 || rejectedLines_ % 1000 == 0) {
+            std::cerr << "Error parsing serial line: " << parseStatusMessage(status)
+                      << " (rejected lines: " << rejectedLines_ << ")" << std::endl;
+        }
+        return;
+    }
+
+    Sample sample;
+    sample.sensorId = sensorId_;
+    sample.timestamp = timestamp;
+    sample.value = value;
+    sample.quality = SampleQuality::Good;
+    samples.push_back(sample);
+}
+
+ParseStatus SampleParser::parseTimestamp(const char *begin, const char *end, time_t &timestamp) {
+    while (begin != end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (end != begin && (*(end - 1) == ' ' || *(end - 1) == '\t')) {
+        --end;
+    }
+    if (begin == end) {
+        return ParseStatus::Empty;
+    }
+    if (end - begin > 18) {
+        return ParseStatus::OutOfRange;
+    }
+
+    long long value = 0;
+    for (const char *p = begin; p != end; ++p) {
+        if (*p < '0' || *p > '9') {
+            return ParseStatus::InvalidCharacter;
+        }
+        value = value * 10 + (*p - '0');
+    }
+
+    timestamp = static_cast<time_t>(value);
+    return ParseStatus::Ok;
+}
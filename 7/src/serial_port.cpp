@@ -105,8 +105,9 @@ bool SerialPort::openPort() {
 
     tty.c_oflag &= ~OPOST;
 
-    tty.c_cc[VMIN] = 1;
-    tty.c_cc[VTIME] = 0;
+    // Reads return after 0.5 s of silence so the acquisition thread can notice a stop request.
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 5;
 
     cfsetospeed(&tty, B9600);
     cfsetispeed(&tty, B9600);
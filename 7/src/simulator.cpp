@@ -0,0 +1,128 @@
+#include "../include/simulator.h"
+#include <cmath>
+
+static const double secondsPerDay = 86400.0;
+static const double twoPi = 6.283185307179586;
+static const double walkReversion = 0.995;
+
+static std::uint64_t splitMix64(std::uint64_t &x) {
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+SensorProfile defaultSensorProfile() {
+    SensorProfile profile;
+    profile.baseTemperature = 20.0;
+    profile.diurnalAmplitude = 3.0;
+    profile.driftPerDay = 0.0;
+    profile.noiseStdDev = 0.1;
+    profile.randomWalkStdDev = 0.05;
+    profile.spikeProbability = 0.0005;
+    profile.spikeMagnitude = 5.0;
+    return profile;
+}
+
+FastRandom::FastRandom(std::uint64_t seed) : spare_(0.0), hasSpare_(false) {
+    state_[0] = splitMix64(seed);
+    state_[1] = splitMix64(seed);
+}
+
+std::uint64_t FastRandom::next() {
+    std::uint64_t s1 = state_[0];
+    const std::uint64_t s0 = state_[1];
+    const std::uint64_t result = s0 + s1;
+    state_[0] = s0;
+    s1 ^= s1 << 23;
+    state_[1] = s1 ^ s0 ^ (s1 >> 18) ^ (s0 >> 5);
+    return result;
+}
+
+double FastRandom::uniform() {
+    return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double FastRandom::gaussian() {
+    if (hasSpare_) {
+        hasSpare_ = false;
+        return spare_;
+    }
+
+    double u, v, s;
+    do {
+        u = uniform() * 2.0 - 1.0;
+        v = uniform() * 2.0 - 1.0;
+        s = u * u + v * v;
+    } while (s >= 1.0 || s == 0.0);
+
+    double factor = std::sqrt(-2.0 * std::log(s) / s);
+    spare_ = v * factor;
+    hasSpare_ = true;
+    return u * factor;
+}
+
+Simulator::Simulator(std::uint64_t seed) : random_(seed) {
+}
+
+int Simulator::addSensor(const SensorProfile &profile, time_t startTime) {
+    VirtualSensor sensor;
+    sensor.profile = profile;
+    sensor.startTime = startTime;
+    sensor.walk = 0.0;
+    sensors_.push_back(sensor);
+    return static_cast<int>(sensors_.size() - 1);
+}
+
+size_t Simulator::getSensorCount() const {
+    return sensors_.size();
+}
+
+void Simulator::generate(time_t start, time_t period, size_t steps, Sample *samples) {
+    for (size_t step = 0; step < steps; ++step) {
+        time_t timestamp = start + static_cast<time_t>(step) * period;
+        for (size_t id = 0; id < sensors_.size(); ++id) {
+            Sample &sample = *samples++;
+            sample.sensorId = static_cast<int>(id);
+            sample.timestamp = timestamp;
+            sample.value = nextValue(sensors_[id], timestamp);
+            sample.quality = SampleQuality::Simulated;
+        }
+    }
+}
+
+void Simulator::generate(time_t start, time_t period, size_t steps, std::vector<Sample> &samples) {
+    size_t offset = samples.size();
+    samples.resize(offset + steps * sensors_.size());
+    generate(start, period, steps, samples.data() + offset);
+}
+
+Sample Simulator::generateOne(int sensorId, time_t timestamp) {
+    Sample sample;
+    sample.sensorId = sensorId;
+    sample.timestamp = timestamp;
+    sample.value = nextValue(sensors_[sensorId], timestamp);
+    sample.quality = SampleQuality::Simulated;
+    return sample;
+}
+
+double Simulator::nextValue(VirtualSensor &sensor, time_t timestamp) {
+    const SensorProfile &profile = sensor.profile;
+
+    double elapsedDays = static_cast<double>(timestamp - sensor.startTime) / secondsPerDay;
+    double dayPhase = static_cast<double>(timestamp % 86400) / secondsPerDay;
+
+    // Coldest around 03:00 UTC, warmest around 15:00 UTC.
+    double diurnal = -profile.diurnalAmplitude * std::cos(twoPi * (dayPhase - 0.125));
+
+    sensor.walk = sensor.walk * walkReversion + profile.randomWalkStdDev * random_.gaussian();
+
+    double value = profile.baseTemperature + profile.driftPerDay * elapsedDays + diurnal + sensor.walk +
+                   profile.noiseStdDev * random_.gaussian();
+
+    if (profile.spikeProbability > 0.0 && random_.uniform() < profile.spikeProbability) {
+        value += random_.uniform() < 0.5 ? -profile.spikeMagnitude : profile.spikeMagnitude;
+    }
+
+    return value;
+}
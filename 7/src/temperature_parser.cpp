@@ -0,0 +1,58 @@
+#include "../include/temperature_parser.h"
+#include <charconv>
+#include <cmath>
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+ParseStatus parseTemperature(const char *begin, const char *end, double &value) {
+    while (begin != end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end != begin && isSpace(*(end - 1))) {
+        --end;
+    }
+    if (begin == end) {
+        return ParseStatus::Empty;
+    }
+    if (*begin == '+') {
+        ++begin;
+        if (begin == end || *begin == '-') {
+            return ParseStatus::InvalidCharacter;
+        }
+    }
+
+    double parsed = 0.0;
+    std::from_chars_result result = std::from_chars(begin, end, parsed, std::chars_format::fixed);
+    if (result.ec == std::errc::result_out_of_range) {
+        return ParseStatus::OutOfRange;
+    }
+    if (result.ec != std::errc() || result.ptr != end) {
+        return ParseStatus::InvalidCharacter;
+    }
+    if (!std::isfinite(parsed)) {
+        return ParseStatus::OutOfRange;
+    }
+
+    value = parsed;
+    return ParseStatus::Ok;
+}
+
+ParseStatus parseTemperature(const std::string &text, double &value) {
+    return parseTemperature(text.data(), text.data() + text.size(), value);
+}
+
+const char *parseStatusMessage(ParseStatus status) {
+    switch (status) {
+    case ParseStatus::Ok:
+        return "ok";
+    case ParseStatus::Empty:
+        return "empty input";
+    case ParseStatus::InvalidCharacter:
+        return "invalid character";
+    case ParseStatus::OutOfRange:
+        return "value out of range";
+    }
+    return "unknown error";
+}